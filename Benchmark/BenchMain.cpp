@@ -0,0 +1,394 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "ActivationKernels.hpp"
+#include "BenchmarkSuite.hpp"
+#include "Dataset.hpp"
+#include "Gemm.hpp"
+#include "KernelVerification.hpp"
+#include "NeuralNetwork.hpp"
+#include "Optimizer.hpp"
+#include "QuantizedKernels.hpp"
+#include "QuantizedNetwork.hpp"
+#include "Workspace.hpp"
+
+#ifndef BENCH_SOURCE_DIR
+#define BENCH_SOURCE_DIR "."
+#endif
+
+namespace fs = std::filesystem;
+
+struct Topology
+{
+    std::string name;
+    std::vector<unsigned int> sizes;
+};
+
+static const std::vector<Topology> TOPOLOGIES{{"4-8-3", {4, 8, 3}}, {"8-64-64-2", {8, 64, 64, 2}}, {"64-256-256-10", {64, 256, 256, 10}}};
+static const std::vector<unsigned int> BATCH_SIZES{1U, 16U, 64U, 256U};
+static const char *FUNCTION_NAMES[] = {"sigmoid", "tanh", "relu", "linear", "softmax"};
+static const char *PRECISION_NAMES[] = {"double", "float", "mixed"};
+
+template <typename T>
+static const char *ScalarName() { return std::is_same_v<T, float> ? "float" : "double"; }
+
+// every activation kernel over a buffer that stays in L1, softmax per row of 16 like an output layer
+template <typename T>
+static void ActivationBenchmarks(BenchmarkSuite &suite)
+{
+    constexpr std::size_t count = 4096U;
+    constexpr std::size_t width = 16U;
+    std::mt19937 rng(1U);
+    std::uniform_real_distribution<double> dist(-4.0, 4.0);
+    std::vector<T> values(count), outputs(count), gradients(count);
+    for (auto &v : values)
+        v = static_cast<T>(dist(rng));
+    for (auto f = 0; f <= SOFTMAX; ++f)
+    {
+        const FUNCTION function = static_cast<FUNCTION>(f);
+        const json params{{"function", FUNCTION_NAMES[f]}, {"precision", ScalarName<T>()}, {"elements", count}};
+        suite.Run("micro", std::string("activation/") + FUNCTION_NAMES[f] + "/" + ScalarName<T>(), params, count, [&]()
+                  {
+                      std::copy(values.begin(), values.end(), outputs.begin());
+                      const std::size_t step = (function == SOFTMAX) ? width : count;
+                      for (std::size_t i = 0; i < count; i += step)
+                          ActivateBatch<T>({outputs.data() + i, step}, function); });
+        if (function == SOFTMAX)
+            continue; // folded into the cross-entropy gradient, there is no derivative kernel
+        suite.Run("micro", std::string("activation_derivative/") + FUNCTION_NAMES[f] + "/" + ScalarName<T>(), params, count, [&]()
+                  {
+                      std::fill(gradients.begin(), gradients.end(), static_cast<T>(1));
+                      ActivateDerivativeBatch<T>(outputs, gradients, function); });
+    }
+}
+
+// the three products of a 1024 wide hidden layer, packed and blocked as the batch path runs them,
+// reported per FLOP (samples/s is FLOP/s)
+template <typename T>
+static void GemmBenchmarks(BenchmarkSuite &suite)
+{
+    constexpr std::size_t width = 1024U;
+    std::mt19937 rng(1U);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    for (std::size_t rows : {1U, 32U, 256U})
+    {
+        std::vector<T> x(rows * width), w(width * width), c(std::max(rows, width) * width);
+        for (auto &v : x)
+            v = static_cast<T>(dist(rng));
+        for (auto &v : w)
+            v = static_cast<T>(dist(rng));
+        AlignedBuffer<T> pack(std::max(GemmPackSize<T>(rows, width, width), GemmPackSize<T>(width, width, rows)));
+        const json params{{"rows", rows}, {"columns", width}, {"inner", width}, {"precision", ScalarName<T>()}, {"unit", "flop"}};
+        const double flops = 2.0 * rows * width * width;
+        const std::string suffix = "/b" + std::to_string(rows) + "/" + ScalarName<T>();
+        suite.Run("micro", "gemm/x_wt" + suffix, params, flops, [&]()
+                  { GemmABt<T>(rows, width, width, x.data(), width, w.data(), width, c.data(), width, T(0), pack.data()); });
+        suite.Run("micro", "gemm/delta_w" + suffix, params, flops, [&]()
+                  { GemmAB<T>(rows, width, width, x.data(), width, w.data(), width, c.data(), width, T(0), pack.data()); });
+        suite.Run("micro", "gemm/deltat_x" + suffix, params, flops, [&]()
+                  { GemmAtB<T>(width, width, rows, x.data(), width, x.data(), width, c.data(), width, T(0), pack.data()); });
+    }
+}
+
+template <typename T>
+static std::vector<Layer<T>> MakeNetwork(const Topology &topology, std::mt19937 &rng)
+{
+    std::vector<Layer<T>> network;
+    network.reserve(topology.sizes.size());
+    for (auto index_layer = 0; index_layer < topology.sizes.size(); ++index_layer)
+    {
+        network.emplace_back(topology.sizes[index_layer], index_layer == 0 ? 0U : topology.sizes[index_layer - 1], 1.0, SIGMOID);
+        network.back().EnableOptimizer(SGD);
+        network.back().RandomizeWeights(rng);
+    }
+    return network;
+}
+
+// the layer kernels the training loop is made of, sigmoid everywhere
+template <typename T>
+static void LayerBenchmarks(BenchmarkSuite &suite)
+{
+    for (const Topology &topology : TOPOLOGIES)
+    {
+        std::mt19937 rng(1U);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        std::vector<Layer<T>> network = MakeNetwork<T>(topology, rng);
+        const std::size_t last = network.size() - 1;
+        const unsigned int outSize = network.back().size();
+        const std::string suffix = topology.name + "/" + ScalarName<T>();
+        const OptimizerStep sgd{.optimizer = SGD, .learningRate = 1e-4, .momentum = 0.5};
+
+        // online path, one sample at a time through the layers' own buffers
+        for (auto c = 0; c < network.front().size(); ++c)
+            network.front().Outputs()[c] = static_cast<T>(dist(rng));
+        const json online{{"topology", topology.sizes}, {"batch", 1}, {"precision", ScalarName<T>()}};
+        suite.Run("micro", "layer/feedforward_online/" + suffix, online, 1.0, [&]()
+                  {
+                      for (auto index_layer = 1; index_layer <= last; ++index_layer)
+                          network[index_layer].template FeedForward<SIGMOID>(network[index_layer - 1]); });
+        unsigned int label = 0U;
+        suite.Run("micro", "layer/backpropagate_online/" + suffix, online, 1.0, [&]()
+                  {
+                      network[last].template CalcOutputGradients<SIGMOID>(label++ % outSize);
+                      for (auto index_layer = last - 1; index_layer > 0; --index_layer)
+                          network[index_layer].template CalcHiddenGradients<SIGMOID>(network[index_layer + 1]);
+                      for (auto index_layer = last; index_layer > 0; --index_layer)
+                          network[index_layer].UpdateInputWeights(network[index_layer - 1], sgd); });
+
+        // batch path, one matrix-matrix product per layer
+        for (unsigned int batch : BATCH_SIZES)
+        {
+            BatchWorkspace<T> ws(network, batch);
+            for (auto r = 0; r < batch; ++r)
+            {
+                for (auto c = 0; c < network.front().size(); ++c)
+                    ws[0].Outputs(r)[c] = static_cast<T>(dist(rng));
+                ws.Labels()[r] = r % outSize;
+            }
+            const json params{{"topology", topology.sizes}, {"batch", batch}, {"precision", ScalarName<T>()}};
+            const std::string name = topology.name + "/b" + std::to_string(batch) + "/" + ScalarName<T>();
+            suite.Run("micro", "layer/feedforward_batch/" + name, params, batch, [&]()
+                      {
+                          for (auto index_layer = 1; index_layer <= last; ++index_layer)
+                              network[index_layer].template FeedForwardBatch<SIGMOID>(ws[index_layer - 1], ws[index_layer], batch); });
+            suite.Run("micro", "layer/backpropagate_batch/" + name, params, batch, [&]()
+                      {
+                          network[last].template CalcOutputGradientsBatch<SIGMOID>(ws[last], ws.Labels(), ws.SampleErrors(), batch);
+                          for (auto index_layer = last - 1; index_layer > 0; --index_layer)
+                              network[index_layer].template CalcHiddenGradientsBatch<SIGMOID>(network[index_layer + 1], ws[index_layer + 1], ws[index_layer], batch);
+                          for (auto index_layer = last; index_layer > 0; --index_layer)
+                              network[index_layer].CalcWeightGradients(ws[index_layer - 1], ws[index_layer], batch); });
+            if (batch != BATCH_SIZES.back())
+                continue;
+            // one update per batch whatever its size, so reported per update (samples = 1)
+            suite.Run("micro", "layer/weight_update/" + suffix, json{{"topology", topology.sizes}, {"precision", ScalarName<T>()}, {"unit", "update"}}, 1.0, [&]()
+                      {
+                          for (auto index_layer = last; index_layer > 0; --index_layer)
+                              network[index_layer].ApplyWeightGradients(ws[index_layer].weightGradients.data(), ws[index_layer].biasGradients.data(), sgd, 1.0 / batch); });
+            // the same update with the two moments and the square root of Adam
+            OptimizerStep adam{.optimizer = ADAM, .learningRate = 1e-4};
+            for (auto index_layer = 1; index_layer <= last; ++index_layer)
+                network[index_layer].EnableOptimizer(ADAM);
+            suite.Run("micro", "layer/weight_update_adam/" + suffix, json{{"topology", topology.sizes}, {"precision", ScalarName<T>()}, {"unit", "update"}}, 1.0, [&]()
+                      {
+                          for (auto index_layer = last; index_layer > 0; --index_layer)
+                              network[index_layer].ApplyWeightGradients(ws[index_layer].weightGradients.data(), ws[index_layer].biasGradients.data(), adam, 1.0 / batch);
+                          ++adam.step; });
+            // AdamW with an L1 penalty on top, both go into the same pass
+            OptimizerStep adamw{.optimizer = ADAMW, .learningRate = 1e-4, .regularization = L1_REGULARIZATION, .regularizationRate = 1e-5, .weightDecay = 0.01};
+            for (auto index_layer = 1; index_layer <= last; ++index_layer)
+                network[index_layer].EnableOptimizer(ADAMW);
+            suite.Run("micro", "layer/weight_update_adamw_l1/" + suffix, json{{"topology", topology.sizes}, {"precision", ScalarName<T>()}, {"unit", "update"}}, 1.0, [&]()
+                      {
+                          for (auto index_layer = last; index_layer > 0; --index_layer)
+                              network[index_layer].ApplyWeightGradients(ws[index_layer].weightGradients.data(), ws[index_layer].biasGradients.data(), adamw, 1.0 / batch);
+                          ++adamw.step; });
+        }
+    }
+}
+
+// rows x cols standard normal features, the class is the largest of the first numClasses features
+static void WriteSyntheticDataset(const fs::path &path, unsigned int rows, unsigned int cols, unsigned int numClasses)
+{
+    std::mt19937 rng(7U);
+    std::normal_distribution<double> dist(0.0, 1.0);
+    std::ofstream f(path, std::ios::trunc);
+    std::vector<double> row(cols);
+    for (auto r = 0; r < rows; ++r)
+    {
+        for (auto &v : row)
+            v = dist(rng);
+        for (auto c = 0; c < cols; ++c)
+            f << row[c] << ',';
+        f << (std::max_element(row.begin(), row.begin() + numClasses) - row.begin()) << '\n';
+    }
+    f.close(); // remember to close file to prevent leak
+}
+
+template <typename T>
+static void DatasetBenchmarks(BenchmarkSuite &suite, const std::vector<std::pair<std::string, json>> &datasets)
+{
+    for (const auto &[name, config] : datasets)
+    {
+        const std::string csv = config["datasetPath"], token = config["tokenPath"];
+        const unsigned int inSize = config["topology"].front();
+        Dataset<T> probe;
+        std::streambuf *console = std::cout.rdbuf(nullptr); // ReadDataset echoes the path
+        probe.ReadDataset(csv, token);
+        std::cout.rdbuf(console);
+        const std::size_t rows = probe.GetData().d_parsed.rows;
+        const json params{{"dataset", name}, {"rows", rows}, {"bytes", fs::file_size(csv)}, {"precision", ScalarName<T>()}};
+        suite.Run("micro", "dataset/read/" + name + "/" + ScalarName<T>(), params, rows, [&]()
+                  {
+                      Dataset<T> dataset;
+                      dataset.ReadDataset(csv, token); });
+        suite.Run("micro", "dataset/read_extract_standardize/" + name + "/" + ScalarName<T>(), params, rows, [&]()
+                  {
+                      Dataset<T> dataset;
+                      dataset.ReadDataset(csv, token);
+                      dataset.ExtractInOut(inSize, STANDARDIZE); });
+    }
+}
+
+// rows the training split of config holds, the network shuffles before splitting but the sizes only depend on the ratios
+static std::size_t TrainingRows(const json &config)
+{
+    Dataset<double> dataset;
+    std::streambuf *console = std::cout.rdbuf(nullptr);
+    dataset.ReadDataset(config["datasetPath"], config["tokenPath"]);
+    std::cout.rdbuf(console);
+    dataset.SplitDataset(config["training_split"], config.value("test_split", config["training_split"].get<double>()));
+    return dataset.GetData().d_training.size();
+}
+
+// whole epochs through NeuralNetwork::Train, then inference over every row through Predict
+static void TrainingBenchmarks(BenchmarkSuite &suite, const fs::path &tempDir, const std::vector<std::pair<std::string, json>> &datasets)
+{
+    for (const auto &[name, base] : datasets)
+    {
+        const std::size_t trainingRows = TrainingRows(base);
+        const unsigned int epochs = (trainingRows > 1000U) ? 1U : 5U; // keep every run well under a second on the big sets
+        for (unsigned short precision = DOUBLE_PRECISION; precision <= MIXED_PRECISION; ++precision)
+            for (unsigned int batch : {1U, 32U})
+            {
+                json config = base;
+                config["precision"] = precision;
+                config["isBatchLearning"] = batch > 1;
+                config["batchSize"] = batch;
+                config["epoch"] = epochs + 1; // the loop runs epoch - 1 passes
+                config["accuracyThreshold"] = 1.0; // never stop early, every run is the same amount of work
+                const fs::path configPath = tempDir / ("train-" + name + ".json");
+                std::ofstream(configPath, std::ios::trunc) << config.dump(4);
+                std::streambuf *console = std::cout.rdbuf(nullptr);
+                NeuralNetwork nn(configPath.string());
+                std::cout.rdbuf(console);
+                const std::string mode = (batch > 1) ? "batch" + std::to_string(batch) : "online";
+                const json params{{"dataset", name}, {"topology", config["topology"]}, {"batch", batch}, {"epochs", epochs},
+                                  {"training_rows", trainingRows}, {"precision", PRECISION_NAMES[precision]}};
+                suite.Run("macro", "train/" + name + "/" + mode + "/" + PRECISION_NAMES[precision], params,
+                          static_cast<double>(epochs * trainingRows), [&]()
+                          { nn.Train(); });
+
+                if (batch > 1)
+                    continue;
+                // inference on the network trained above, raw rows through the float API
+                Dataset<float> dataset;
+                std::streambuf *quiet = std::cout.rdbuf(nullptr);
+                dataset.ReadDataset(config["datasetPath"], config["tokenPath"]);
+                std::cout.rdbuf(quiet);
+                const unsigned int inSize = config["topology"].front(), outSize = config["topology"].back();
+                const RowMatrix<float> &parsed = dataset.GetData().d_parsed;
+                std::vector<float> inputs, outputs(parsed.rows * outSize);
+                inputs.reserve(parsed.rows * inSize);
+                for (auto r = 0; r < parsed.rows; ++r)
+                    inputs.insert(inputs.end(), parsed[r].begin(), parsed[r].begin() + inSize);
+                const json predict{{"dataset", name}, {"topology", config["topology"]}, {"rows", parsed.rows}, {"precision", PRECISION_NAMES[precision]}};
+                suite.Run("macro", "predict/" + name + "/" + PRECISION_NAMES[precision], predict, parsed.rows, [&]()
+                          { nn.Predict(inputs, parsed.rows, outputs); });
+                if (precision != SINGLE_PRECISION)
+                    continue;
+                const fs::path quantizedPath = tempDir / ("quantized-" + name + ".bin");
+                config["quantizedExportPath"] = quantizedPath.string();
+                config["epoch"] = 2;
+                std::ofstream(configPath, std::ios::trunc) << config.dump(4);
+                quiet = std::cout.rdbuf(nullptr);
+                NeuralNetwork exporter(configPath.string());
+                exporter.Train();
+                std::cout.rdbuf(quiet);
+                QuantizedNetwork quantized;
+                if (!quantized.Load(quantizedPath.string()))
+                    continue;
+                suite.Run("macro", "predict/" + name + "/int8", json{{"dataset", name}, {"topology", config["topology"]}, {"rows", parsed.rows}, {"precision", "int8"}},
+                          parsed.rows, [&]()
+                          { quantized.Predict(inputs, parsed.rows, outputs); });
+            }
+    }
+}
+
+// the bundled default config of a dataset, with absolute paths and nothing written to disk
+static json LoadDefaultConfig(const std::string &file, const std::string &csv, const std::string &token)
+{
+    std::ifstream f(std::string(BENCH_SOURCE_DIR) + "/" + file);
+    if (!f.is_open())
+    {
+        std::cerr << "Failed to open file! Config Path : " << file << std::endl;
+        exit(-1);
+    }
+    json config = json::parse(f);
+    config["datasetPath"] = std::string(BENCH_SOURCE_DIR) + "/Dataset/" + csv;
+    config["tokenPath"] = std::string(BENCH_SOURCE_DIR) + "/Dataset/" + token;
+    config["importWeightPath"] = "";
+    config["exportWeightPath"] = "";
+    config["quantizedExportPath"] = "";
+    config["verbosity"] = 0;
+    config["seed"] = 1;
+    return config;
+}
+
+int main(int argc, char **argv)
+{
+    std::string outPath = "bench.json";
+    std::string filter = "";
+    double minSeconds = 0.2;
+    for (auto i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (arg == "--filter" && i + 1 < argc)
+            filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc)
+            minSeconds = std::atof(argv[++i]);
+        else if (arg == "--verify")
+            return (VerifyKernels() == 0U) ? 0 : 1;
+        else
+        {
+            std::cerr << "Command not recognize!" << std::endl
+                      << "Syntax:" << std::endl;
+            std::cout << "./bench [--out results.json] [--filter name] [--min-time seconds] | ./bench --verify" << std::endl;
+            exit(-1);
+        }
+    }
+
+    const fs::path tempDir = fs::temp_directory_path() / "snn-bench";
+    fs::create_directories(tempDir);
+    // wide synthetic data, far more columns and rows than the bundled datasets
+    constexpr unsigned int syntheticRows = 8192U, syntheticCols = 256U, syntheticClasses = 4U;
+    const fs::path syntheticPath = tempDir / "synthetic-wide.csv";
+    WriteSyntheticDataset(syntheticPath, syntheticRows, syntheticCols, syntheticClasses);
+    json synthetic = LoadDefaultConfig("DefaultConfigIris.json", "", "");
+    synthetic["datasetPath"] = syntheticPath.string();
+    synthetic["tokenPath"] = "";
+    synthetic["topology"] = {syntheticCols, 256, 128, syntheticClasses};
+    synthetic["hiddenLayerActivation"] = RELU;
+    synthetic["outputLayerActivation"] = SOFTMAX;
+    synthetic["learning_rate"] = 0.01;
+    const std::vector<std::pair<std::string, json>> datasets{
+        {"iris", LoadDefaultConfig("DefaultConfigIris.json", "iris-dataset.csv", "iris-token.json")},
+        {"breast-cancer", LoadDefaultConfig("DefaultConfigBreastCancer.json", "breast-cancer-dataset.csv", "breast-cancer-token.json")},
+        {"synthetic-wide", synthetic}};
+
+    std::printf("Activation kernels : %s, GEMM kernels : %s, optimizer kernels : %s, quantized kernels : %s\n", ActivationKernelName(), GemmKernelName(),
+                OptimizerKernelName(), QuantizedKernelName());
+    BenchmarkSuite suite(minSeconds, filter);
+    ActivationBenchmarks<double>(suite);
+    ActivationBenchmarks<float>(suite);
+    GemmBenchmarks<double>(suite);
+    GemmBenchmarks<float>(suite);
+    LayerBenchmarks<double>(suite);
+    LayerBenchmarks<float>(suite);
+    DatasetBenchmarks<double>(suite, datasets);
+    DatasetBenchmarks<float>(suite, datasets);
+    TrainingBenchmarks(suite, tempDir, datasets);
+
+    if (!suite.WriteJson(outPath))
+    {
+        std::cerr << "Failed to open file! Benchmark Output : " << outPath << std::endl;
+        exit(-1);
+    }
+    std::cout << suite.Results().size() << " benchmarks written to : " << outPath << std::endl;
+}
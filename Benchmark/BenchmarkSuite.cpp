@@ -0,0 +1,39 @@
+#include <cstdio>
+#include <fstream>
+#include "AllocationCounter.hpp"
+#include "BenchmarkSuite.hpp"
+
+// every allocation of the benchmark binary is counted, see AllocationCounter.cpp
+AllocationCount AllocationsSoFar()
+{
+    return AllocationCount{HeapBytes(), HeapAllocations()};
+}
+
+void BenchmarkSuite::Report(const BenchmarkResult &result) const
+{
+    std::printf("%-58s %12.1f ns/sample %14.0f samples/s %12.0f B/iter %8.1f allocs/iter\n", result.name.c_str(),
+                result.nsPerSample, result.samplesPerSec, result.bytesPerIteration, result.allocsPerIteration);
+    std::fflush(stdout);
+}
+
+bool BenchmarkSuite::WriteJson(const std::string &path) const
+{
+    json results = json::array();
+    for (const BenchmarkResult &result : m_results)
+        results.push_back({{"name", result.name},
+                           {"group", result.group},
+                           {"params", result.params},
+                           {"iterations", result.iterations},
+                           {"samples_per_iteration", result.samples},
+                           {"seconds", result.seconds},
+                           {"ns_per_sample", result.nsPerSample},
+                           {"samples_per_sec", result.samplesPerSec},
+                           {"bytes_allocated_per_iteration", result.bytesPerIteration},
+                           {"allocations_per_iteration", result.allocsPerIteration}});
+    std::ofstream f(path, std::ios::trunc);
+    if (!f.is_open())
+        return false;
+    f << json{{"benchmarks", results}}.dump(2) << std::endl;
+    f.close(); // remember to close file to prevent leak
+    return f.good();
+}
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef BENCHMARKSUITE_H
+#define BENCHMARKSUITE_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+// heap traffic of the whole process, counted by the operator new replacements in AllocationCounter.cpp
+struct AllocationCount
+{
+    std::uint64_t bytes = 0U;
+    std::uint64_t allocations = 0U;
+};
+AllocationCount AllocationsSoFar();
+
+// discards everything written to it without allocating
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    std::string group;        // "micro" (one kernel) or "macro" (end to end)
+    json params;              // topology, batch size, precision, ... of this run
+    std::uint64_t iterations = 0U;
+    double samples = 0.0;     // samples processed by one iteration
+    double seconds = 0.0;     // wall time of all timed iterations
+    double nsPerSample = 0.0;
+    double samplesPerSec = 0.0;
+    double bytesPerIteration = 0.0; // heap bytes allocated by one iteration
+    double allocsPerIteration = 0.0;
+};
+
+/* @brief
+ *   Minimal benchmark harness, no third party framework
+ *   Run() does one untimed warm-up call, then repeats fn until minSeconds have passed
+ *   and records time and heap allocations per iteration
+ *   Anything fn prints to std::cout is swallowed so the table stays readable
+ */
+class BenchmarkSuite
+{
+public:
+    BenchmarkSuite(double minSeconds, const std::string &filter) : m_minSeconds(minSeconds), m_filter(filter) {}
+
+    // samples is how many samples one call of fn processes, used for samples/sec and ns/sample
+    template <typename Fn>
+    void Run(const std::string &group, const std::string &name, const json &params, double samples, Fn &&fn)
+    {
+        if (!m_filter.empty() && name.find(m_filter) == std::string::npos)
+            return;
+        std::streambuf *console = std::cout.rdbuf(&m_null);
+        fn(); // warm-up, first touch of caches, workspaces and lazily built tables
+        BenchmarkResult result{name, group, params};
+        result.samples = samples;
+        const AllocationCount before = AllocationsSoFar();
+        const auto start = std::chrono::steady_clock::now();
+        do
+        {
+            fn();
+            ++result.iterations;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (result.seconds < m_minSeconds);
+        const AllocationCount after = AllocationsSoFar();
+        std::cout.rdbuf(console);
+        result.nsPerSample = result.seconds * 1e9 / (result.iterations * samples);
+        result.samplesPerSec = result.iterations * samples / result.seconds;
+        result.bytesPerIteration = static_cast<double>(after.bytes - before.bytes) / result.iterations;
+        result.allocsPerIteration = static_cast<double>(after.allocations - before.allocations) / result.iterations;
+        Report(result);
+        m_results.push_back(std::move(result));
+    }
+
+    bool WriteJson(const std::string &path) const;
+    inline const std::vector<BenchmarkResult> &Results() const { return m_results; }
+
+private:
+    void Report(const BenchmarkResult &result) const; // one line per benchmark on the console
+
+    double m_minSeconds = 0.2;
+    std::string m_filter = ""; // substring of the benchmark names to run, empty runs all
+    std::vector<BenchmarkResult> m_results;
+    NullBuffer m_null;
+};
+
+#endif
@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "ActivationKernels.hpp"
+#include "AlignedBuffer.hpp"
+#include "Gemm.hpp"
+#include "KernelVerification.hpp"
+#include "Optimizer.hpp"
+#include "QuantizedKernels.hpp"
+
+namespace
+{
+    // one named check over many cases, errors are measured as a fraction of each case's tolerance
+    class Check
+    {
+    public:
+        explicit Check(std::string name) : m_name(std::move(name)) {}
+
+        void Expect(double error, double tolerance, const std::string &where)
+        {
+            ++m_cases;
+            const double ratio = (tolerance > 0.0) ? error / tolerance : (error == 0.0 ? 0.0 : INFINITY);
+            // NaN fails too
+            if (!(ratio <= 1.0))
+            {
+                if (m_failures++ == 0)
+                    m_firstFailure = where;
+            }
+            if (!(ratio <= m_worst))
+                m_worst = ratio;
+        }
+
+        // prints the result line, returns 1 if any case failed
+        unsigned int Report() const
+        {
+            std::printf("%-36s %6u cases  worst %8.3g of tolerance  %s\n", m_name.c_str(), m_cases, m_worst,
+                        m_failures == 0 ? "ok" : "FAILED");
+            if (m_failures != 0)
+                std::printf("    %u failed, first at %s\n", m_failures, m_firstFailure.c_str());
+            return (m_failures == 0) ? 0U : 1U;
+        }
+
+    private:
+        std::string m_name;
+        unsigned int m_cases = 0U;
+        unsigned int m_failures = 0U;
+        double m_worst = 0.0;
+        std::string m_firstFailure;
+    };
+
+    template <typename T>
+    const char *ScalarName() { return std::is_same_v<T, float> ? "float" : "double"; }
+
+    template <typename T>
+    void Fill(T *x, std::size_t n, std::mt19937 &rng, double lo = -1.0, double hi = 1.0)
+    {
+        std::uniform_real_distribution<double> dist(lo, hi);
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = static_cast<T>(dist(rng));
+    }
+
+    // scales the tile of C by aux in place, the derivative scaling epilogue of the backward pass
+    template <typename T>
+    void ScaleByAux(T *c, T *aux, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            c[i] *= aux[i];
+    }
+
+    enum GEMM_FORM
+    {
+        GEMM_ABT = 0,
+        GEMM_AB,
+        GEMM_ATB
+    };
+    const char *GEMM_FORM_NAMES[] = {"abt", "ab", "atb"};
+
+    // the edge sizes around every microkernel tile (4, 6 and 8 rows) and the MC block, K across a KC block
+    const std::vector<std::size_t> GEMM_M{1, 5, 6, 7, 8, 64, 253, 256, 300};
+    const std::vector<std::size_t> GEMM_N{1, 13, 50, 200};
+    const std::vector<std::size_t> GEMM_K{1, 17, 300};
+    constexpr std::size_t GEMM_PAD = 3;    // row strides are wider than the rows
+    constexpr std::size_t GEMM_GUARD = 64; // elements behind the pack buffer that have to stay untouched
+
+    // every form with and without a pack buffer, beta = 0 and beta = 1 with an epilogue, against a double loop
+    template <typename T>
+    void VerifyGemm(std::vector<Check> &checks)
+    {
+        std::mt19937 rng(11);
+        const double epsilon = std::numeric_limits<T>::epsilon();
+        for (int form = GEMM_ABT; form <= GEMM_ATB; ++form)
+        {
+            for (const bool packed : {false, true})
+            {
+                Check check(std::string("gemm/") + GEMM_FORM_NAMES[form] + (packed ? "/packed/" : "/") + ScalarName<T>());
+                for (const std::size_t M : GEMM_M)
+                    for (const std::size_t N : GEMM_N)
+                        for (const std::size_t K : GEMM_K)
+                        {
+                            // a is M x K and b is N x K logically, stored as the form reads them
+                            const bool aTransposed = (form == GEMM_ATB), bTransposed = (form != GEMM_ABT);
+                            const std::size_t lda = (aTransposed ? M : K) + GEMM_PAD, ldb = (bTransposed ? N : K) + GEMM_PAD;
+                            const std::size_t ldc = N + GEMM_PAD;
+                            AlignedBuffer<T> A((aTransposed ? K : M) * lda), B((bTransposed ? K : N) * ldb);
+                            AlignedBuffer<T> C0(M * ldc), aux(M * ldc), bias(N);
+                            Fill(A.data(), A.size(), rng);
+                            Fill(B.data(), B.size(), rng);
+                            Fill(C0.data(), C0.size(), rng);
+                            Fill(aux.data(), aux.size(), rng);
+                            Fill(bias.data(), bias.size(), rng);
+                            auto a = [&](std::size_t i, std::size_t k) { return aTransposed ? A[k * lda + i] : A[i * lda + k]; };
+                            auto b = [&](std::size_t j, std::size_t k) { return bTransposed ? B[k * ldb + j] : B[j * ldb + k]; };
+
+                            AlignedBuffer<T> pack(packed ? GemmPackSize<T>(M, N, K) + GEMM_GUARD : 0U);
+                            const T guard = T(12345);
+                            std::fill(pack.begin(), pack.end(), guard);
+                            T *packData = packed ? pack.data() : nullptr;
+
+                            for (const bool accumulate : {false, true})
+                            {
+                                // the epilogue is only taken by the forward and hidden gradient forms
+                                const bool withEpilogue = accumulate && form != GEMM_ATB;
+                                AlignedBuffer<T> C(M * ldc);
+                                std::copy(C0.begin(), C0.end(), C.begin());
+                                const T beta = accumulate ? T(1) : T(0);
+                                GemmEpilogue<T> epilogue;
+                                if (withEpilogue)
+                                {
+                                    epilogue.apply = ScaleByAux<T>;
+                                    epilogue.aux = aux.data();
+                                    epilogue.ldaux = ldc;
+                                    epilogue.bias = bias.data();
+                                    epilogue.biasScale = T(0.5);
+                                }
+                                if (form == GEMM_ABT)
+                                    GemmABt<T>(M, N, K, A.data(), lda, B.data(), ldb, C.data(), ldc, beta, packData, epilogue);
+                                else if (form == GEMM_AB)
+                                    GemmAB<T>(M, N, K, A.data(), lda, B.data(), ldb, C.data(), ldc, beta, packData, epilogue);
+                                else
+                                    GemmAtB<T>(M, N, K, A.data(), lda, B.data(), ldb, C.data(), ldc, beta, packData);
+
+                                double worst = 0.0, bound = 1.0;
+                                for (std::size_t i = 0; i < M; ++i)
+                                    for (std::size_t j = 0; j < N; ++j)
+                                    {
+                                        double sum = 0.0, magnitude = 0.0;
+                                        for (std::size_t k = 0; k < K; ++k)
+                                        {
+                                            sum += static_cast<double>(a(i, k)) * b(j, k);
+                                            magnitude += std::fabs(static_cast<double>(a(i, k)) * b(j, k));
+                                        }
+                                        if (accumulate)
+                                        {
+                                            sum += C0[i * ldc + j];
+                                            magnitude += std::fabs(static_cast<double>(C0[i * ldc + j]));
+                                        }
+                                        if (withEpilogue)
+                                        {
+                                            sum = (sum + 0.5 * bias[j]) * aux[i * ldc + j];
+                                            magnitude = (magnitude + std::fabs(0.5 * bias[j])) * std::fabs(static_cast<double>(aux[i * ldc + j]));
+                                        }
+                                        worst = std::max(worst, std::fabs(C[i * ldc + j] - sum));
+                                        bound = std::max(bound, magnitude);
+                                    }
+                                // the padding between rows of C is not part of the product
+                                for (std::size_t i = 0; i < M; ++i)
+                                    for (std::size_t j = N; j < ldc; ++j)
+                                        if (C[i * ldc + j] != C0[i * ldc + j])
+                                            worst = INFINITY;
+                                const std::string where = "M=" + std::to_string(M) + " N=" + std::to_string(N) + " K=" + std::to_string(K) +
+                                                          (accumulate ? " beta=1" : " beta=0");
+                                check.Expect(worst, 4.0 * (K + 2) * epsilon * bound, where);
+                            }
+                            bool overrun = false;
+                            if (packed)
+                                for (std::size_t i = pack.size() - GEMM_GUARD; i < pack.size(); ++i)
+                                    overrun = overrun || (pack[i] != guard);
+                            check.Expect(overrun ? 1.0 : 0.0, 0.0, "pack buffer overrun at M=" + std::to_string(M) + " N=" + std::to_string(N) +
+                                                                       " K=" + std::to_string(K));
+                        }
+                checks.push_back(check);
+            }
+        }
+    }
+
+    // lengths around every vector width (2 to 16 lanes) and its tail, plus a few long spans
+    const std::vector<std::size_t> ACTIVATION_N{1, 3, 7, 8, 15, 16, 17, 31, 64, 100, 1000};
+    // inputs past where exp over- or underflows, the kernels clamp them
+    const std::vector<double> ACTIVATION_EXTREMES{0.0, 1e-3, -1e-3, 40.0, -40.0, 100.0, -100.0};
+
+    // activation of a whole span in place against activate<F>() of Activation.hpp evaluated in double,
+    // the error is absolute up to 1 and relative above, where the outputs of sigmoid and tanh live
+    template <FUNCTION F, typename T>
+    void VerifyActivation(std::vector<Check> &checks, const char *name, double lo, double hi)
+    {
+        std::mt19937 rng(13);
+        const double epsilon = std::numeric_limits<T>::epsilon();
+        Check check(std::string("activation/") + name + "/" + ScalarName<T>());
+        for (const std::size_t n : ACTIVATION_N)
+        {
+            std::vector<T> x(n);
+            Fill(x.data(), n, rng, lo, hi);
+            for (std::size_t i = 0; i < std::min(n, ACTIVATION_EXTREMES.size()); ++i)
+                x[(i * 7) % n] = static_cast<T>(ACTIVATION_EXTREMES[i]);
+            std::vector<T> y = x;
+            ActivateBatch<F, T>(std::span<T>(y));
+            double worst = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const double reference = activate<F>(static_cast<double>(x[i]));
+                worst = std::max(worst, std::fabs(y[i] - reference) / std::max(std::fabs(reference), 1.0));
+            }
+            // the vector exp is a polynomial good to about 1e-14 relative in double, float rounding in float
+            check.Expect(worst, 64.0 * epsilon, "n=" + std::to_string(n));
+        }
+        checks.push_back(check);
+    }
+
+    // tanh of tiny inputs, relative to the output since tanh(x) ~ x, where 1 - exp(-2|x|) would cancel
+    template <typename T>
+    void VerifyTanhNearZero(std::vector<Check> &checks)
+    {
+        std::mt19937 rng(29);
+        std::uniform_real_distribution<double> exponent(-12.0, 0.0);
+        const double epsilon = std::numeric_limits<T>::epsilon();
+        Check check(std::string("activation/tanh_near_zero/") + ScalarName<T>());
+        for (const std::size_t n : ACTIVATION_N)
+        {
+            std::vector<T> x(n);
+            for (std::size_t i = 0; i < n; ++i)
+                x[i] = static_cast<T>((i % 2 ? -1.0 : 1.0) * std::pow(10.0, exponent(rng))); // 1e-12 to 1, both signs
+            std::vector<T> y = x;
+            ActivateBatch<TANH, T>(std::span<T>(y));
+            double worst = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const double reference = std::tanh(static_cast<double>(x[i]));
+                worst = std::max(worst, std::fabs(y[i] - reference) / std::fabs(reference));
+            }
+            // same bound as above, but relative all the way down instead of absolute below 1
+            check.Expect(worst, 64.0 * epsilon, "n=" + std::to_string(n));
+        }
+        checks.push_back(check);
+    }
+
+    // softmax of rows against exp(x - max) / sum in double, relative to the largest probability
+    template <typename T>
+    void VerifySoftmax(std::vector<Check> &checks)
+    {
+        std::mt19937 rng(17);
+        const double epsilon = std::numeric_limits<T>::epsilon();
+        Check check(std::string("activation/softmax/") + ScalarName<T>());
+        for (const std::size_t n : ACTIVATION_N)
+        {
+            std::vector<T> x(n);
+            Fill(x.data(), n, rng, -20.0, 20.0);
+            std::vector<T> y = x;
+            SoftmaxBatch(std::span<T>(y));
+            const double max = *std::max_element(x.begin(), x.end());
+            double sum = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+                sum += std::exp(x[i] - max);
+            double worst = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+                worst = std::max(worst, std::fabs(y[i] - std::exp(x[i] - max) / sum));
+            check.Expect(worst, 16.0 * epsilon, "n=" + std::to_string(n));
+        }
+        checks.push_back(check);
+    }
+
+    // grad *= f'(out) against activateDerivative<F>() in double, outputs drawn from the range of f
+    template <FUNCTION F, typename T>
+    void VerifyDerivative(std::vector<Check> &checks, const char *name, double lo, double hi)
+    {
+        std::mt19937 rng(19);
+        const double epsilon = std::numeric_limits<T>::epsilon();
+        Check check(std::string("activation/") + name + "_derivative/" + ScalarName<T>());
+        for (const std::size_t n : ACTIVATION_N)
+        {
+            std::vector<T> out(n), grad(n);
+            Fill(out.data(), n, rng, lo, hi);
+            Fill(grad.data(), n, rng);
+            out[n / 2] = T(0); // relu's kink
+            std::vector<T> result = grad;
+            ActivateDerivativeBatch<F, T>(std::span<const T>(out), std::span<T>(result));
+            double worst = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+                worst = std::max(worst, std::fabs(result[i] - grad[i] * activateDerivative<F>(static_cast<double>(out[i]))));
+            check.Expect(worst, 4.0 * epsilon, "n=" + std::to_string(n));
+        }
+        checks.push_back(check);
+    }
+
+    template <typename T>
+    void VerifyActivations(std::vector<Check> &checks)
+    {
+        VerifyActivation<SIGMOID, T>(checks, "sigmoid", -30.0, 30.0);
+        VerifyActivation<TANH, T>(checks, "tanh", -10.0, 10.0);
+        VerifyTanhNearZero<T>(checks);
+        VerifyActivation<RELU, T>(checks, "relu", -1.0, 1.0);
+        VerifySoftmax<T>(checks);
+        VerifyDerivative<SIGMOID, T>(checks, "sigmoid", 0.0, 1.0);
+        VerifyDerivative<TANH, T>(checks, "tanh", -1.0, 1.0);
+        VerifyDerivative<RELU, T>(checks, "relu", -1.0, 1.0);
+    }
+
+    // u8 x s8 products against an int32 loop, every implementation has to match it exactly
+    // K is padded to whole cache lines like the quantized layers do, the extremes of both ranges are included
+    void VerifyQuantized(std::vector<Check> &checks)
+    {
+        std::mt19937 rng(23);
+        std::uniform_int_distribution<int> activation(0, QUANT_ACTIVATION_MAX), weight(-QUANT_WEIGHT_MAX, QUANT_WEIGHT_MAX);
+        Check check("int8/gemm_u8s8");
+        for (const std::size_t M : {1U, 5U, 17U})
+            for (const std::size_t N : {1U, 7U, 33U})
+                for (const std::size_t K : {64U, 128U, 320U})
+                {
+                    const std::size_t lda = K + 64, ldb = K + 64, ldc = N + 1;
+                    AlignedBuffer<std::uint8_t> A(M * lda);
+                    AlignedBuffer<std::int8_t> B(N * ldb);
+                    for (std::size_t i = 0; i < A.size(); ++i)
+                        A[i] = static_cast<std::uint8_t>(activation(rng));
+                    for (std::size_t i = 0; i < B.size(); ++i)
+                        B[i] = static_cast<std::int8_t>(weight(rng));
+                    // the largest sums of both signs
+                    std::fill(A.data(), A.data() + K, static_cast<std::uint8_t>(QUANT_ACTIVATION_MAX));
+                    std::fill(B.data(), B.data() + K, static_cast<std::int8_t>(QUANT_WEIGHT_MAX));
+                    if (N > 1)
+                        std::fill(B.data() + ldb, B.data() + ldb + K, static_cast<std::int8_t>(-QUANT_WEIGHT_MAX));
+                    std::vector<std::int32_t> C(M * ldc, 0);
+                    GemmU8S8(M, N, K, A.data(), lda, B.data(), ldb, C.data(), ldc);
+                    double worst = 0.0;
+                    for (std::size_t i = 0; i < M; ++i)
+                        for (std::size_t j = 0; j < N; ++j)
+                        {
+                            std::int32_t sum = 0;
+                            for (std::size_t k = 0; k < K; ++k)
+                                sum += static_cast<std::int32_t>(A[i * lda + k]) * B[j * ldb + k];
+                            worst = std::max(worst, std::fabs(static_cast<double>(C[i * ldc + j]) - sum));
+                        }
+                    check.Expect(worst, 0.0, "M=" + std::to_string(M) + " N=" + std::to_string(N) + " K=" + std::to_string(K));
+                }
+        checks.push_back(check);
+    }
+
+    const char *OPTIMIZER_NAMES[] = {"sgd", "nesterov", "rmsprop", "adam", "adamw"};
+
+    // one step of the update rule for a single weight, written out from its definition in double
+    // (no folded coefficients), g is the gradient a * x in the direction the weights move
+    void ReferenceUpdate(const OptimizerStep &step, double g, double &w, double &s0, double &s1)
+    {
+        const double sign = (w > 0) - (w < 0);
+        if (step.regularization == L1_REGULARIZATION)
+            g -= step.regularizationRate * sign;
+        else if (step.regularization == L2_REGULARIZATION)
+            g -= step.regularizationRate * w;
+        const double decayed = w * (1.0 - step.learningRate * step.weightDecay);
+        switch (step.optimizer)
+        {
+        case NESTEROV:
+            s0 = step.learningRate * g + step.momentum * s0;
+            w = decayed + step.learningRate * g + step.momentum * s0;
+            break;
+        case RMSPROP:
+            s0 = step.beta2 * s0 + (1.0 - step.beta2) * g * g;
+            w = decayed + step.learningRate * g / (std::sqrt(s0) + step.epsilon);
+            break;
+        case ADAM:
+        case ADAMW:
+        {
+            s0 = step.beta1 * s0 + (1.0 - step.beta1) * g;
+            s1 = step.beta2 * s1 + (1.0 - step.beta2) * g * g;
+            const double mean = s0 / (1.0 - std::pow(step.beta1, static_cast<double>(step.step)));
+            const double square = s1 / (1.0 - std::pow(step.beta2, static_cast<double>(step.step)));
+            w = decayed + step.learningRate * mean / (std::sqrt(square) + step.epsilon);
+            break;
+        }
+        default:
+            s0 = step.learningRate * g + step.momentum * s0;
+            w = decayed + s0;
+        }
+    }
+
+    // a few consecutive steps of every update rule, with and without each penalty and weight decay,
+    // weights and state against ReferenceUpdate(), P is the parameter type and X the gradient type
+    // (float gradients into double parameters is the mixed precision form, checked with its float shadow)
+    template <typename P, typename X>
+    void VerifyOptimizer(std::vector<Check> &checks)
+    {
+        constexpr bool mixed = !std::is_same_v<P, X>;
+        constexpr unsigned int steps = 3U;
+        constexpr std::size_t padding = 3; // zero weights fed zero inputs, like the end of a weight row
+        constexpr double a = 0.7;
+        std::mt19937 rng(29);
+        // the gradient scale is rounded to X, so mixed precision is only as exact as float there
+        const double epsilon = std::numeric_limits<X>::epsilon();
+        for (int optimizer = SGD; optimizer <= ADAMW; ++optimizer)
+        {
+            Check check(std::string("optimizer/") + OPTIMIZER_NAMES[optimizer] + "/" + ScalarName<P>() + (mixed ? "<-float" : ""));
+            for (int regularization = NO_REGULARIZATION; regularization <= L2_REGULARIZATION + 1; ++regularization)
+                for (const std::size_t n : {1U, 7U, 17U, 100U})
+                {
+                    OptimizerStep step;
+                    step.optimizer = static_cast<OPTIMIZER>(optimizer);
+                    step.learningRate = 0.05;
+                    // the last case is decoupled weight decay on its own
+                    step.regularization = (regularization <= L2_REGULARIZATION) ? static_cast<REGULARIZATION>(regularization) : NO_REGULARIZATION;
+                    step.regularizationRate = 0.01;
+                    step.weightDecay = (regularization > L2_REGULARIZATION || step.optimizer == ADAMW) ? 0.01 : 0.0;
+                    const std::size_t total = n + padding;
+                    std::vector<P> w(total, P(0)), s0(total, P(0)), s1(total, P(0));
+                    std::vector<X> x(total, X(0)), shadow(total, X(0));
+                    Fill(w.data(), n, rng);
+                    std::vector<double> rw(w.begin(), w.end()), rs0(total, 0.0), rs1(total, 0.0);
+
+                    double worst = 0.0;
+                    for (step.step = 1; step.step <= steps; ++step.step)
+                    {
+                        Fill(x.data(), n, rng);
+                        if constexpr (mixed)
+                            OptimizerUpdate(step, w.data(), s0.data(), s1.data(), x.data(), a, total, shadow.data());
+                        else
+                            OptimizerUpdate(step, w.data(), s0.data(), s1.data(), x.data(), a, total);
+                        for (std::size_t i = 0; i < total; ++i)
+                        {
+                            ReferenceUpdate(step, a * x[i], rw[i], rs0[i], rs1[i]);
+                            // the padding has to stay exactly zero
+                            if (i >= n && (w[i] != 0 || s0[i] != 0 || s1[i] != 0))
+                                worst = INFINITY;
+                            worst = std::max(worst, std::fabs(w[i] - rw[i]) / std::max(std::fabs(rw[i]), 1.0));
+                            worst = std::max(worst, std::fabs(s0[i] - rs0[i]) / std::max(std::fabs(rs0[i]), 1.0));
+                            worst = std::max(worst, std::fabs(s1[i] - rs1[i]) / std::max(std::fabs(rs1[i]), 1.0));
+                            // the shadow is the master weight rounded once
+                            if (mixed && shadow[i] != static_cast<X>(w[i]))
+                                worst = INFINITY;
+                        }
+                    }
+                    const char *variants[] = {"", " l1", " l2", " decay"};
+                    check.Expect(worst, 64.0 * epsilon, "n=" + std::to_string(n) + variants[regularization]);
+                }
+            checks.push_back(check);
+        }
+    }
+}
+
+unsigned int VerifyKernels()
+{
+    std::printf("gemm kernels: %s, activation kernels: %s, int8 kernels: %s, optimizer kernels: %s\n\n", GemmKernelName(),
+                ActivationKernelName(), QuantizedKernelName(), OptimizerKernelName());
+    std::vector<Check> checks;
+    VerifyGemm<float>(checks);
+    VerifyGemm<double>(checks);
+    VerifyActivations<float>(checks);
+    VerifyActivations<double>(checks);
+    VerifyQuantized(checks);
+    VerifyOptimizer<float, float>(checks);
+    VerifyOptimizer<double, double>(checks);
+    VerifyOptimizer<double, float>(checks);
+
+    unsigned int failed = 0U;
+    for (const Check &check : checks)
+        failed += check.Report();
+    std::printf("\n%u of %zu checks failed\n", failed, checks.size());
+    return failed;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#ifndef KERNELVERIFICATION_H
+#define KERNELVERIFICATION_H
+
+/* @brief
+ *   bench --verify, runs every kernel the dispatch selected against a plain scalar reference
+ *   and prints one line per check with the worst error found relative to its tolerance
+ *   Only the implementation the dispatch picks is checked, run it once per instruction set
+ *   with SNN_ISA (see KernelDispatch.hpp) to cover all of them, the run_verify target does
+ *   Returns the number of failed checks
+ */
+unsigned int VerifyKernels();
+
+#endif
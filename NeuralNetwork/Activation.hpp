@@ -10,10 +10,11 @@ enum FUNCTION
     SIGMOID = 0,
     TANH,
     RELU,
-    LINEAR
+    LINEAR,
+    SOFTMAX // output layer only, normalizes the whole layer and pairs with the cross-entropy loss
 };
 
-double activate(double x, FUNCTION func)
+inline double activate(double x, FUNCTION func)
 {
     switch (func)
     {
@@ -28,7 +29,7 @@ double activate(double x, FUNCTION func)
     }
 }
 
-double activateDerivative(double x, FUNCTION func)
+inline double activateDerivative(double x, FUNCTION func)
 {
     switch (func)
     {
@@ -42,4 +43,52 @@ double activateDerivative(double x, FUNCTION func)
         return 1;
     }
 }
+
+// compile time versions, the switch is resolved when the template is instantiated
+// SOFTMAX is not element wise, it only exists as SoftmaxBatch, its derivative is folded into the p - y gradient
+template <FUNCTION F>
+inline double activate(double x)
+{
+    if constexpr (F == RELU)
+        return std::max(x, 0.0);
+    else if constexpr (F == TANH)
+        return std::tanh(x);
+    else if constexpr (F == SIGMOID)
+        return (1 / (1 + std::exp(-x)));
+    else
+        return x;
+}
+
+template <FUNCTION F>
+inline double activateDerivative(double x)
+{
+    if constexpr (F == RELU)
+        return x > 0;
+    else if constexpr (F == TANH)
+        return 1 - x * x;
+    else if constexpr (F == SIGMOID)
+        return x * (1 - x);
+    else
+        return 1;
+}
+
+// call fn.template operator()<F>() with the runtime activation turned into a template argument
+// meant to run once per layer (or once per training run), never per neuron
+template <typename Fn>
+inline decltype(auto) DispatchActivation(FUNCTION func, Fn &&fn)
+{
+    switch (func)
+    {
+    case RELU:
+        return fn.template operator()<RELU>();
+    case TANH:
+        return fn.template operator()<TANH>();
+    case SIGMOID:
+        return fn.template operator()<SIGMOID>();
+    case SOFTMAX:
+        return fn.template operator()<SOFTMAX>();
+    default:
+        return fn.template operator()<LINEAR>();
+    }
+}
 #endif
\ No newline at end of file
@@ -0,0 +1,734 @@
+#include "ActivationKernels.hpp"
+#include "KernelDispatch.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NN_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    template <typename T>
+    struct KernelTable
+    {
+        using ActivateFn = void (*)(T *x, std::size_t n);
+        using DerivativeFn = void (*)(const T *out, T *grad, std::size_t n);
+
+        ActivateFn sigmoid;
+        ActivateFn tanh;
+        ActivateFn relu;
+        ActivateFn softmax;
+        DerivativeFn sigmoidDerivative;
+        DerivativeFn tanhDerivative;
+        DerivativeFn reluDerivative;
+        const char *name;
+    };
+
+    // scalar fallback, exact std::exp/std::tanh through the reference functions
+    template <typename T>
+    void SigmoidScalar(T *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = activate<SIGMOID>(x[i]);
+    }
+    template <typename T>
+    void TanhScalar(T *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = activate<TANH>(x[i]);
+    }
+    template <typename T>
+    void ReluScalar(T *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = activate<RELU>(x[i]);
+    }
+    template <typename T>
+    void SoftmaxScalar(T *x, std::size_t n)
+    {
+        if (n == 0)
+            return;
+        const T max = *std::max_element(x, x + n);
+        T sum = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            x[i] = std::exp(x[i] - max);
+            sum += x[i];
+        }
+        const T scale = 1 / sum;
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] *= scale;
+    }
+    template <typename T>
+    void SigmoidDerivativeScalar(const T *out, T *grad, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            grad[i] *= activateDerivative<SIGMOID>(out[i]);
+    }
+    template <typename T>
+    void TanhDerivativeScalar(const T *out, T *grad, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            grad[i] *= activateDerivative<TANH>(out[i]);
+    }
+    template <typename T>
+    void ReluDerivativeScalar(const T *out, T *grad, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            grad[i] *= activateDerivative<RELU>(out[i]);
+    }
+
+#ifdef NN_X86_DISPATCH
+    // exp(x) = 2^k * exp(r), k = round(x / ln2), |r| <= ln2 / 2
+    // exp(r) is a degree 11 polynomial, about 1e-14 relative error over the clamped range
+    constexpr double EXP_MAX = 708.0;
+    constexpr double LOG2E = 1.4426950408889634;
+    constexpr double LN2_HI = 6.93145751953125E-1;
+    constexpr double LN2_LO = 1.42860682030941723212E-6;
+    constexpr double EXP_COEFF[] = {1.0 / 39916800, 1.0 / 3628800, 1.0 / 362880, 1.0 / 40320,
+                                    1.0 / 5040, 1.0 / 720, 1.0 / 120, 1.0 / 24,
+                                    1.0 / 6, 1.0 / 2, 1.0, 1.0};
+    constexpr double ROUND_MAGIC = 6755399441055744.0; // 1.5 * 2^52, integer lands in the low mantissa bits
+    // near zero 1 - exp(-2|x|) cancels, below TANH_SERIES_MAX tanh(x) = x * p(x^2) with the Taylor terms up to x^21
+    // (the first term left out is below 1e-18 relative there), above it the cancellation costs at most a few ulp
+    constexpr double TANH_SERIES_MAX = 0.25;
+    constexpr double TANH_COEFF[] = {18888466084.0 / 194896477400625, -443861162.0 / 1856156927625, 6404582.0 / 10854718875,
+                                     -929569.0 / 638512875, 21844.0 / 6081075, -1382.0 / 155925,
+                                     62.0 / 2835, -17.0 / 315, 2.0 / 15, -1.0 / 3, 1.0};
+
+    // ---------------------------------- AVX2 ----------------------------------
+    __attribute__((target("avx2,fma"))) inline __m256d Exp256(__m256d x)
+    {
+        x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-EXP_MAX)), _mm256_set1_pd(EXP_MAX));
+        __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_HI), x);
+        r = _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_LO), r);
+        __m256d p = _mm256_set1_pd(EXP_COEFF[0]);
+        for (int c = 1; c < 12; ++c)
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(EXP_COEFF[c]));
+        // build 2^k straight into the exponent bits
+        __m256i bits = _mm256_castpd_si256(_mm256_add_pd(k, _mm256_set1_pd(ROUND_MAGIC)));
+        bits = _mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52);
+        return _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+    }
+
+    __attribute__((target("avx2,fma"))) inline __m256d Sigmoid256(__m256d x)
+    {
+        const __m256d one = _mm256_set1_pd(1.0);
+        return _mm256_div_pd(one, _mm256_add_pd(one, Exp256(_mm256_sub_pd(_mm256_setzero_pd(), x))));
+    }
+
+    __attribute__((target("avx2,fma"))) inline __m256d Tanh256(__m256d x)
+    {
+        // tanh(|x|) = (1 - e) / (1 + e) with e = exp(-2|x|), then restore the sign
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d signMask = _mm256_set1_pd(-0.0);
+        __m256d ax = _mm256_andnot_pd(signMask, x);
+        __m256d e = Exp256(_mm256_mul_pd(ax, _mm256_set1_pd(-2.0)));
+        __m256d t = _mm256_div_pd(_mm256_sub_pd(one, e), _mm256_add_pd(one, e));
+        __m256d x2 = _mm256_mul_pd(ax, ax);
+        __m256d p = _mm256_set1_pd(TANH_COEFF[0]);
+        for (int c = 1; c < 11; ++c)
+            p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(TANH_COEFF[c]));
+        t = _mm256_blendv_pd(t, _mm256_mul_pd(p, ax), _mm256_cmp_pd(ax, _mm256_set1_pd(TANH_SERIES_MAX), _CMP_LT_OQ));
+        return _mm256_or_pd(t, _mm256_and_pd(signMask, x));
+    }
+
+    __attribute__((target("avx2,fma"))) void SigmoidAvx2(double *x, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(x + i, Sigmoid256(_mm256_loadu_pd(x + i)));
+        SigmoidScalar(x + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) void TanhAvx2(double *x, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(x + i, Tanh256(_mm256_loadu_pd(x + i)));
+        TanhScalar(x + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) void ReluAvx2(double *x, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(x + i, _mm256_max_pd(_mm256_loadu_pd(x + i), _mm256_setzero_pd()));
+        ReluScalar(x + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) inline double HorizontalAdd256(__m256d v)
+    {
+        __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+
+    __attribute__((target("avx2,fma"))) void SoftmaxAvx2(double *x, std::size_t n)
+    {
+        if (n == 0)
+            return;
+        // three passes over the layer: max, exp(x - max) with the running sum, scale by 1 / sum
+        std::size_t i = 0;
+        __m256d vmax = _mm256_set1_pd(-HUGE_VAL);
+        for (; i + 4 <= n; i += 4)
+            vmax = _mm256_max_pd(vmax, _mm256_loadu_pd(x + i));
+        double lanes[4];
+        _mm256_storeu_pd(lanes, vmax);
+        double max = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        for (; i < n; ++i)
+            max = std::max(max, x[i]);
+
+        const __m256d shift = _mm256_set1_pd(max);
+        __m256d vsum = _mm256_setzero_pd();
+        for (i = 0; i + 4 <= n; i += 4)
+        {
+            __m256d e = Exp256(_mm256_sub_pd(_mm256_loadu_pd(x + i), shift));
+            _mm256_storeu_pd(x + i, e);
+            vsum = _mm256_add_pd(vsum, e);
+        }
+        double sum = HorizontalAdd256(vsum);
+        for (; i < n; ++i)
+        {
+            x[i] = std::exp(x[i] - max);
+            sum += x[i];
+        }
+
+        const __m256d scale = _mm256_set1_pd(1.0 / sum);
+        for (i = 0; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), scale));
+        for (; i < n; ++i)
+            x[i] *= 1.0 / sum;
+    }
+
+    __attribute__((target("avx2,fma"))) void SigmoidDerivativeAvx2(const double *out, double *grad, std::size_t n)
+    {
+        std::size_t i = 0;
+        const __m256d one = _mm256_set1_pd(1.0);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d o = _mm256_loadu_pd(out + i);
+            __m256d d = _mm256_mul_pd(o, _mm256_sub_pd(one, o));
+            _mm256_storeu_pd(grad + i, _mm256_mul_pd(_mm256_loadu_pd(grad + i), d));
+        }
+        SigmoidDerivativeScalar(out + i, grad + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) void TanhDerivativeAvx2(const double *out, double *grad, std::size_t n)
+    {
+        std::size_t i = 0;
+        const __m256d one = _mm256_set1_pd(1.0);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d o = _mm256_loadu_pd(out + i);
+            __m256d d = _mm256_fnmadd_pd(o, o, one);
+            _mm256_storeu_pd(grad + i, _mm256_mul_pd(_mm256_loadu_pd(grad + i), d));
+        }
+        TanhDerivativeScalar(out + i, grad + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) void ReluDerivativeAvx2(const double *out, double *grad, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d active = _mm256_cmp_pd(_mm256_loadu_pd(out + i), _mm256_setzero_pd(), _CMP_GT_OQ);
+            _mm256_storeu_pd(grad + i, _mm256_and_pd(_mm256_loadu_pd(grad + i), active));
+        }
+        ReluDerivativeScalar(out + i, grad + i, n - i);
+    }
+
+    // single precision, same scheme with a degree 7 polynomial, exact to float rounding
+    constexpr float EXP_MAX_F = 87.0f;
+    constexpr float LN2_HI_F = 0.693359375f;
+    constexpr float LN2_LO_F = -2.12194440e-4f;
+    constexpr float EXP_COEFF_F[] = {1.0f / 5040, 1.0f / 720, 1.0f / 120, 1.0f / 24,
+                                     1.0f / 6, 1.0f / 2, 1.0f, 1.0f};
+    constexpr float ROUND_MAGIC_F = 12582912.0f; // 1.5 * 2^23
+    constexpr float TANH_SERIES_MAX_F = 0.25f;
+    constexpr float TANH_COEFF_F[] = {62.0f / 2835, -17.0f / 315, 2.0f / 15, -1.0f / 3, 1.0f}; // up to x^9
+
+    __attribute__((target("avx2,fma"))) inline __m256 Exp256(__m256 x)
+    {
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-EXP_MAX_F)), _mm256_set1_ps(EXP_MAX_F));
+        __m256 k = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(static_cast<float>(LOG2E))), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 r = _mm256_fnmadd_ps(k, _mm256_set1_ps(LN2_HI_F), x);
+        r = _mm256_fnmadd_ps(k, _mm256_set1_ps(LN2_LO_F), r);
+        __m256 p = _mm256_set1_ps(EXP_COEFF_F[0]);
+        for (int c = 1; c < 8; ++c)
+            p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_COEFF_F[c]));
+        __m256i bits = _mm256_castps_si256(_mm256_add_ps(k, _mm256_set1_ps(ROUND_MAGIC_F)));
+        bits = _mm256_slli_epi32(_mm256_add_epi32(bits, _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(bits));
+    }
+
+    __attribute__((target("avx2,fma"))) inline __m256 Sigmoid256(__m256 x)
+    {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        return _mm256_div_ps(one, _mm256_add_ps(one, Exp256(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+    }
+
+    __attribute__((target("avx2,fma"))) inline __m256 Tanh256(__m256 x)
+    {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        __m256 ax = _mm256_andnot_ps(signMask, x);
+        __m256 e = Exp256(_mm256_mul_ps(ax, _mm256_set1_ps(-2.0f)));
+        __m256 t = _mm256_div_ps(_mm256_sub_ps(one, e), _mm256_add_ps(one, e));
+        __m256 x2 = _mm256_mul_ps(ax, ax);
+        __m256 p = _mm256_set1_ps(TANH_COEFF_F[0]);
+        for (int c = 1; c < 5; ++c)
+            p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(TANH_COEFF_F[c]));
+        t = _mm256_blendv_ps(t, _mm256_mul_ps(p, ax), _mm256_cmp_ps(ax, _mm256_set1_ps(TANH_SERIES_MAX_F), _CMP_LT_OQ));
+        return _mm256_or_ps(t, _mm256_and_ps(signMask, x));
+    }
+
+    __attribute__((target("avx2,fma"))) void SigmoidAvx2(float *x, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(x + i, Sigmoid256(_mm256_loadu_ps(x + i)));
+        SigmoidScalar(x + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) void TanhAvx2(float *x, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(x + i, Tanh256(_mm256_loadu_ps(x + i)));
+        TanhScalar(x + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) void ReluAvx2(float *x, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(x + i, _mm256_max_ps(_mm256_loadu_ps(x + i), _mm256_setzero_ps()));
+        ReluScalar(x + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) inline float HorizontalAdd256(__m256 v)
+    {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_movehdup_ps(s)));
+    }
+
+    __attribute__((target("avx2,fma"))) void SoftmaxAvx2(float *x, std::size_t n)
+    {
+        if (n == 0)
+            return;
+        std::size_t i = 0;
+        __m256 vmax = _mm256_set1_ps(-HUGE_VALF);
+        for (; i + 8 <= n; i += 8)
+            vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(x + i));
+        float lanes[8];
+        _mm256_storeu_ps(lanes, vmax);
+        float max = *std::max_element(lanes, lanes + 8);
+        for (; i < n; ++i)
+            max = std::max(max, x[i]);
+
+        const __m256 shift = _mm256_set1_ps(max);
+        __m256 vsum = _mm256_setzero_ps();
+        for (i = 0; i + 8 <= n; i += 8)
+        {
+            __m256 e = Exp256(_mm256_sub_ps(_mm256_loadu_ps(x + i), shift));
+            _mm256_storeu_ps(x + i, e);
+            vsum = _mm256_add_ps(vsum, e);
+        }
+        float sum = HorizontalAdd256(vsum);
+        for (; i < n; ++i)
+        {
+            x[i] = std::exp(x[i] - max);
+            sum += x[i];
+        }
+
+        const __m256 scale = _mm256_set1_ps(1.0f / sum);
+        for (i = 0; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), scale));
+        for (; i < n; ++i)
+            x[i] *= 1.0f / sum;
+    }
+
+    __attribute__((target("avx2,fma"))) void SigmoidDerivativeAvx2(const float *out, float *grad, std::size_t n)
+    {
+        std::size_t i = 0;
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 o = _mm256_loadu_ps(out + i);
+            __m256 d = _mm256_mul_ps(o, _mm256_sub_ps(one, o));
+            _mm256_storeu_ps(grad + i, _mm256_mul_ps(_mm256_loadu_ps(grad + i), d));
+        }
+        SigmoidDerivativeScalar(out + i, grad + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) void TanhDerivativeAvx2(const float *out, float *grad, std::size_t n)
+    {
+        std::size_t i = 0;
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 o = _mm256_loadu_ps(out + i);
+            __m256 d = _mm256_fnmadd_ps(o, o, one);
+            _mm256_storeu_ps(grad + i, _mm256_mul_ps(_mm256_loadu_ps(grad + i), d));
+        }
+        TanhDerivativeScalar(out + i, grad + i, n - i);
+    }
+
+    __attribute__((target("avx2,fma"))) void ReluDerivativeAvx2(const float *out, float *grad, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 active = _mm256_cmp_ps(_mm256_loadu_ps(out + i), _mm256_setzero_ps(), _CMP_GT_OQ);
+            _mm256_storeu_ps(grad + i, _mm256_and_ps(_mm256_loadu_ps(grad + i), active));
+        }
+        ReluDerivativeScalar(out + i, grad + i, n - i);
+    }
+
+    // --------------------------------- AVX-512 --------------------------------
+    // the tail is handled with masked loads/stores, no scalar remainder loop
+    __attribute__((target("avx512f"))) inline __m512d Exp512(__m512d x)
+    {
+        x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(-EXP_MAX)), _mm512_set1_pd(EXP_MAX));
+        __m512d k = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(LN2_HI), x);
+        r = _mm512_fnmadd_pd(k, _mm512_set1_pd(LN2_LO), r);
+        __m512d p = _mm512_set1_pd(EXP_COEFF[0]);
+        for (int c = 1; c < 12; ++c)
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(EXP_COEFF[c]));
+        __m512i bits = _mm512_castpd_si512(_mm512_add_pd(k, _mm512_set1_pd(ROUND_MAGIC)));
+        bits = _mm512_slli_epi64(_mm512_add_epi64(bits, _mm512_set1_epi64(1023)), 52);
+        return _mm512_mul_pd(p, _mm512_castsi512_pd(bits));
+    }
+
+    __attribute__((target("avx512f"))) inline __m512d Sigmoid512(__m512d x)
+    {
+        const __m512d one = _mm512_set1_pd(1.0);
+        return _mm512_div_pd(one, _mm512_add_pd(one, Exp512(_mm512_sub_pd(_mm512_setzero_pd(), x))));
+    }
+
+    __attribute__((target("avx512f"))) inline __m512d Tanh512(__m512d x)
+    {
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512i signMask = _mm512_set1_epi64(0x8000000000000000LL);
+        __m512i xi = _mm512_castpd_si512(x);
+        __m512d ax = _mm512_castsi512_pd(_mm512_andnot_si512(signMask, xi));
+        __m512d e = Exp512(_mm512_mul_pd(ax, _mm512_set1_pd(-2.0)));
+        __m512d t = _mm512_div_pd(_mm512_sub_pd(one, e), _mm512_add_pd(one, e));
+        __m512d x2 = _mm512_mul_pd(ax, ax);
+        __m512d p = _mm512_set1_pd(TANH_COEFF[0]);
+        for (int c = 1; c < 11; ++c)
+            p = _mm512_fmadd_pd(p, x2, _mm512_set1_pd(TANH_COEFF[c]));
+        t = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(ax, _mm512_set1_pd(TANH_SERIES_MAX), _CMP_LT_OQ), t, _mm512_mul_pd(p, ax));
+        return _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(t), _mm512_and_si512(signMask, xi)));
+    }
+
+    __attribute__((target("avx512f"))) inline __mmask8 TailMask(std::size_t remaining)
+    {
+        return remaining >= 8 ? __mmask8(0xFF) : __mmask8((1U << remaining) - 1U);
+    }
+
+    __attribute__((target("avx512f"))) void SigmoidAvx512(double *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __mmask8 m = TailMask(n - i);
+            _mm512_mask_storeu_pd(x + i, m, Sigmoid512(_mm512_maskz_loadu_pd(m, x + i)));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void TanhAvx512(double *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __mmask8 m = TailMask(n - i);
+            _mm512_mask_storeu_pd(x + i, m, Tanh512(_mm512_maskz_loadu_pd(m, x + i)));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void ReluAvx512(double *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __mmask8 m = TailMask(n - i);
+            _mm512_mask_storeu_pd(x + i, m, _mm512_max_pd(_mm512_maskz_loadu_pd(m, x + i), _mm512_setzero_pd()));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void SoftmaxAvx512(double *x, std::size_t n)
+    {
+        if (n == 0)
+            return;
+        // masked out lanes load as -inf for the max and as 0 for the sum
+        __m512d vmax = _mm512_set1_pd(-HUGE_VAL);
+        for (std::size_t i = 0; i < n; i += 8)
+            vmax = _mm512_max_pd(vmax, _mm512_mask_loadu_pd(_mm512_set1_pd(-HUGE_VAL), TailMask(n - i), x + i));
+        const __m512d shift = _mm512_set1_pd(_mm512_reduce_max_pd(vmax));
+        __m512d vsum = _mm512_setzero_pd();
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __mmask8 m = TailMask(n - i);
+            __m512d e = _mm512_maskz_mov_pd(m, Exp512(_mm512_sub_pd(_mm512_maskz_loadu_pd(m, x + i), shift)));
+            _mm512_mask_storeu_pd(x + i, m, e);
+            vsum = _mm512_add_pd(vsum, e);
+        }
+        const __m512d scale = _mm512_set1_pd(1.0 / _mm512_reduce_add_pd(vsum));
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __mmask8 m = TailMask(n - i);
+            _mm512_mask_storeu_pd(x + i, m, _mm512_mul_pd(_mm512_maskz_loadu_pd(m, x + i), scale));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void SigmoidDerivativeAvx512(const double *out, double *grad, std::size_t n)
+    {
+        const __m512d one = _mm512_set1_pd(1.0);
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __mmask8 m = TailMask(n - i);
+            __m512d o = _mm512_maskz_loadu_pd(m, out + i);
+            __m512d d = _mm512_mul_pd(o, _mm512_sub_pd(one, o));
+            _mm512_mask_storeu_pd(grad + i, m, _mm512_mul_pd(_mm512_maskz_loadu_pd(m, grad + i), d));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void TanhDerivativeAvx512(const double *out, double *grad, std::size_t n)
+    {
+        const __m512d one = _mm512_set1_pd(1.0);
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __mmask8 m = TailMask(n - i);
+            __m512d o = _mm512_maskz_loadu_pd(m, out + i);
+            __m512d d = _mm512_fnmadd_pd(o, o, one);
+            _mm512_mask_storeu_pd(grad + i, m, _mm512_mul_pd(_mm512_maskz_loadu_pd(m, grad + i), d));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void ReluDerivativeAvx512(const double *out, double *grad, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; i += 8)
+        {
+            __mmask8 m = TailMask(n - i);
+            // lanes with out <= 0 are written back as zero
+            __mmask8 active = _mm512_mask_cmp_pd_mask(m, _mm512_maskz_loadu_pd(m, out + i), _mm512_setzero_pd(), _CMP_GT_OQ);
+            _mm512_mask_storeu_pd(grad + i, m, _mm512_maskz_loadu_pd(active, grad + i));
+        }
+    }
+
+    // single precision, 16 lanes, the tail mask is 16 bits wide
+    __attribute__((target("avx512f"))) inline __m512 Exp512(__m512 x)
+    {
+        x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-EXP_MAX_F)), _mm512_set1_ps(EXP_MAX_F));
+        __m512 k = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(static_cast<float>(LOG2E))), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512 r = _mm512_fnmadd_ps(k, _mm512_set1_ps(LN2_HI_F), x);
+        r = _mm512_fnmadd_ps(k, _mm512_set1_ps(LN2_LO_F), r);
+        __m512 p = _mm512_set1_ps(EXP_COEFF_F[0]);
+        for (int c = 1; c < 8; ++c)
+            p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_COEFF_F[c]));
+        __m512i bits = _mm512_castps_si512(_mm512_add_ps(k, _mm512_set1_ps(ROUND_MAGIC_F)));
+        bits = _mm512_slli_epi32(_mm512_add_epi32(bits, _mm512_set1_epi32(127)), 23);
+        return _mm512_mul_ps(p, _mm512_castsi512_ps(bits));
+    }
+
+    __attribute__((target("avx512f"))) inline __m512 Sigmoid512(__m512 x)
+    {
+        const __m512 one = _mm512_set1_ps(1.0f);
+        return _mm512_div_ps(one, _mm512_add_ps(one, Exp512(_mm512_sub_ps(_mm512_setzero_ps(), x))));
+    }
+
+    __attribute__((target("avx512f"))) inline __m512 Tanh512(__m512 x)
+    {
+        const __m512 one = _mm512_set1_ps(1.0f);
+        const __m512i signMask = _mm512_set1_epi32(0x80000000);
+        __m512i xi = _mm512_castps_si512(x);
+        __m512 ax = _mm512_castsi512_ps(_mm512_andnot_si512(signMask, xi));
+        __m512 e = Exp512(_mm512_mul_ps(ax, _mm512_set1_ps(-2.0f)));
+        __m512 t = _mm512_div_ps(_mm512_sub_ps(one, e), _mm512_add_ps(one, e));
+        __m512 x2 = _mm512_mul_ps(ax, ax);
+        __m512 p = _mm512_set1_ps(TANH_COEFF_F[0]);
+        for (int c = 1; c < 5; ++c)
+            p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(TANH_COEFF_F[c]));
+        t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(ax, _mm512_set1_ps(TANH_SERIES_MAX_F), _CMP_LT_OQ), t, _mm512_mul_ps(p, ax));
+        return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(t), _mm512_and_si512(signMask, xi)));
+    }
+
+    __attribute__((target("avx512f"))) inline __mmask16 TailMask16(std::size_t remaining)
+    {
+        return remaining >= 16 ? __mmask16(0xFFFF) : __mmask16((1U << remaining) - 1U);
+    }
+
+    __attribute__((target("avx512f"))) void SigmoidAvx512(float *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; i += 16)
+        {
+            __mmask16 m = TailMask16(n - i);
+            _mm512_mask_storeu_ps(x + i, m, Sigmoid512(_mm512_maskz_loadu_ps(m, x + i)));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void TanhAvx512(float *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; i += 16)
+        {
+            __mmask16 m = TailMask16(n - i);
+            _mm512_mask_storeu_ps(x + i, m, Tanh512(_mm512_maskz_loadu_ps(m, x + i)));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void ReluAvx512(float *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; i += 16)
+        {
+            __mmask16 m = TailMask16(n - i);
+            _mm512_mask_storeu_ps(x + i, m, _mm512_max_ps(_mm512_maskz_loadu_ps(m, x + i), _mm512_setzero_ps()));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void SoftmaxAvx512(float *x, std::size_t n)
+    {
+        if (n == 0)
+            return;
+        __m512 vmax = _mm512_set1_ps(-HUGE_VALF);
+        for (std::size_t i = 0; i < n; i += 16)
+            vmax = _mm512_max_ps(vmax, _mm512_mask_loadu_ps(_mm512_set1_ps(-HUGE_VALF), TailMask16(n - i), x + i));
+        const __m512 shift = _mm512_set1_ps(_mm512_reduce_max_ps(vmax));
+        __m512 vsum = _mm512_setzero_ps();
+        for (std::size_t i = 0; i < n; i += 16)
+        {
+            __mmask16 m = TailMask16(n - i);
+            __m512 e = _mm512_maskz_mov_ps(m, Exp512(_mm512_sub_ps(_mm512_maskz_loadu_ps(m, x + i), shift)));
+            _mm512_mask_storeu_ps(x + i, m, e);
+            vsum = _mm512_add_ps(vsum, e);
+        }
+        const __m512 scale = _mm512_set1_ps(1.0f / _mm512_reduce_add_ps(vsum));
+        for (std::size_t i = 0; i < n; i += 16)
+        {
+            __mmask16 m = TailMask16(n - i);
+            _mm512_mask_storeu_ps(x + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, x + i), scale));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void SigmoidDerivativeAvx512(const float *out, float *grad, std::size_t n)
+    {
+        const __m512 one = _mm512_set1_ps(1.0f);
+        for (std::size_t i = 0; i < n; i += 16)
+        {
+            __mmask16 m = TailMask16(n - i);
+            __m512 o = _mm512_maskz_loadu_ps(m, out + i);
+            __m512 d = _mm512_mul_ps(o, _mm512_sub_ps(one, o));
+            _mm512_mask_storeu_ps(grad + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, grad + i), d));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void TanhDerivativeAvx512(const float *out, float *grad, std::size_t n)
+    {
+        const __m512 one = _mm512_set1_ps(1.0f);
+        for (std::size_t i = 0; i < n; i += 16)
+        {
+            __mmask16 m = TailMask16(n - i);
+            __m512 o = _mm512_maskz_loadu_ps(m, out + i);
+            __m512 d = _mm512_fnmadd_ps(o, o, one);
+            _mm512_mask_storeu_ps(grad + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, grad + i), d));
+        }
+    }
+
+    __attribute__((target("avx512f"))) void ReluDerivativeAvx512(const float *out, float *grad, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; i += 16)
+        {
+            __mmask16 m = TailMask16(n - i);
+            __mmask16 active = _mm512_mask_cmp_ps_mask(m, _mm512_maskz_loadu_ps(m, out + i), _mm512_setzero_ps(), _CMP_GT_OQ);
+            _mm512_mask_storeu_ps(grad + i, m, _mm512_maskz_loadu_ps(active, grad + i));
+        }
+    }
+#endif
+
+    template <typename T>
+    KernelTable<T> SelectKernels()
+    {
+#ifdef NN_X86_DISPATCH
+        __builtin_cpu_init();
+        if (IsaAllowed(ISA_AVX512) && __builtin_cpu_supports("avx512f"))
+            return {SigmoidAvx512, TanhAvx512, ReluAvx512, SoftmaxAvx512,
+                    SigmoidDerivativeAvx512, TanhDerivativeAvx512, ReluDerivativeAvx512, "avx512"};
+        if (IsaAllowed(ISA_AVX2) && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return {SigmoidAvx2, TanhAvx2, ReluAvx2, SoftmaxAvx2,
+                    SigmoidDerivativeAvx2, TanhDerivativeAvx2, ReluDerivativeAvx2, "avx2"};
+#endif
+        return {SigmoidScalar<T>, TanhScalar<T>, ReluScalar<T>, SoftmaxScalar<T>,
+                SigmoidDerivativeScalar<T>, TanhDerivativeScalar<T>, ReluDerivativeScalar<T>, "scalar"};
+    }
+
+    // resolved once per scalar type, on first use
+    template <typename T>
+    const KernelTable<T> &Kernels()
+    {
+        static const KernelTable<T> table = SelectKernels<T>();
+        return table;
+    }
+}
+
+void SigmoidBatch(std::span<double> x) { Kernels<double>().sigmoid(x.data(), x.size()); }
+void TanhBatch(std::span<double> x) { Kernels<double>().tanh(x.data(), x.size()); }
+void ReluBatch(std::span<double> x) { Kernels<double>().relu(x.data(), x.size()); }
+void LinearBatch(std::span<double>) {} // identity
+void SoftmaxBatch(std::span<double> x) { Kernels<double>().softmax(x.data(), x.size()); }
+
+void SigmoidDerivativeBatch(std::span<const double> out, std::span<double> grad) { Kernels<double>().sigmoidDerivative(out.data(), grad.data(), grad.size()); }
+void TanhDerivativeBatch(std::span<const double> out, std::span<double> grad) { Kernels<double>().tanhDerivative(out.data(), grad.data(), grad.size()); }
+void ReluDerivativeBatch(std::span<const double> out, std::span<double> grad) { Kernels<double>().reluDerivative(out.data(), grad.data(), grad.size()); }
+void LinearDerivativeBatch(std::span<const double>, std::span<double>) {} // f'(x) = 1
+
+void SigmoidBatch(std::span<float> x) { Kernels<float>().sigmoid(x.data(), x.size()); }
+void TanhBatch(std::span<float> x) { Kernels<float>().tanh(x.data(), x.size()); }
+void ReluBatch(std::span<float> x) { Kernels<float>().relu(x.data(), x.size()); }
+void LinearBatch(std::span<float>) {}
+void SoftmaxBatch(std::span<float> x) { Kernels<float>().softmax(x.data(), x.size()); }
+
+void SigmoidDerivativeBatch(std::span<const float> out, std::span<float> grad) { Kernels<float>().sigmoidDerivative(out.data(), grad.data(), grad.size()); }
+void TanhDerivativeBatch(std::span<const float> out, std::span<float> grad) { Kernels<float>().tanhDerivative(out.data(), grad.data(), grad.size()); }
+void ReluDerivativeBatch(std::span<const float> out, std::span<float> grad) { Kernels<float>().reluDerivative(out.data(), grad.data(), grad.size()); }
+void LinearDerivativeBatch(std::span<const float>, std::span<float>) {}
+
+template <typename T>
+void ActivateBatch(std::span<T> x, FUNCTION func)
+{
+    switch (func)
+    {
+    case RELU:
+        return ReluBatch(x);
+    case TANH:
+        return TanhBatch(x);
+    case SIGMOID:
+        return SigmoidBatch(x);
+    case SOFTMAX:
+        return SoftmaxBatch(x);
+    default:
+        return LinearBatch(x);
+    }
+}
+
+template <typename T>
+void ActivateDerivativeBatch(std::span<const T> out, std::span<T> grad, FUNCTION func)
+{
+    switch (func)
+    {
+    case RELU:
+        return ReluDerivativeBatch(out, grad);
+    case TANH:
+        return TanhDerivativeBatch(out, grad);
+    case SIGMOID:
+        return SigmoidDerivativeBatch(out, grad);
+    default:
+        return LinearDerivativeBatch(out, grad);
+    }
+}
+
+template void ActivateBatch<double>(std::span<double>, FUNCTION);
+template void ActivateBatch<float>(std::span<float>, FUNCTION);
+template void ActivateDerivativeBatch<double>(std::span<const double>, std::span<double>, FUNCTION);
+template void ActivateDerivativeBatch<float>(std::span<const float>, std::span<float>, FUNCTION);
+
+const char *ActivationKernelName() { return Kernels<double>().name; }
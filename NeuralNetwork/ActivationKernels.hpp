@@ -0,0 +1,76 @@
+#pragma once
+#ifndef ACTIVATIONKERNELS_H
+#define ACTIVATIONKERNELS_H
+
+#include <span>
+#include "Activation.hpp"
+
+/* @brief
+ *   Batch versions of the activation functions, applied to a whole span per call
+ *   The implementation (AVX-512, AVX2 or scalar) is picked once at startup from the CPU features
+ *   Activations work in place, derivatives scale the gradients by f'(output): grad[i] *= f'(out[i])
+ *   Every function exists for double and float, the layer kernels pick one through their scalar type
+ */
+void SigmoidBatch(std::span<double> x);
+void TanhBatch(std::span<double> x);
+void ReluBatch(std::span<double> x);
+void LinearBatch(std::span<double> x);
+// exp(x - max) / sum, max subtracted first (log-sum-exp) so no exp can overflow
+void SoftmaxBatch(std::span<double> x);
+
+void SigmoidDerivativeBatch(std::span<const double> out, std::span<double> grad);
+void TanhDerivativeBatch(std::span<const double> out, std::span<double> grad);
+void ReluDerivativeBatch(std::span<const double> out, std::span<double> grad);
+void LinearDerivativeBatch(std::span<const double> out, std::span<double> grad);
+
+// single precision, twice the lanes per vector
+void SigmoidBatch(std::span<float> x);
+void TanhBatch(std::span<float> x);
+void ReluBatch(std::span<float> x);
+void LinearBatch(std::span<float> x);
+void SoftmaxBatch(std::span<float> x);
+
+void SigmoidDerivativeBatch(std::span<const float> out, std::span<float> grad);
+void TanhDerivativeBatch(std::span<const float> out, std::span<float> grad);
+void ReluDerivativeBatch(std::span<const float> out, std::span<float> grad);
+void LinearDerivativeBatch(std::span<const float> out, std::span<float> grad);
+
+// switch on the activation once per span instead of once per value
+template <typename T>
+void ActivateBatch(std::span<T> x, FUNCTION func);
+template <typename T>
+void ActivateDerivativeBatch(std::span<const T> out, std::span<T> grad, FUNCTION func);
+
+// compile time selected versions for the templated layer kernels, no switch left at all
+template <FUNCTION F, typename T>
+inline void ActivateBatch(std::span<T> x)
+{
+    if constexpr (F == RELU)
+        ReluBatch(x);
+    else if constexpr (F == TANH)
+        TanhBatch(x);
+    else if constexpr (F == SIGMOID)
+        SigmoidBatch(x);
+    else if constexpr (F == SOFTMAX)
+        SoftmaxBatch(x);
+    else
+        LinearBatch(x);
+}
+
+template <FUNCTION F, typename T>
+inline void ActivateDerivativeBatch(std::span<const T> out, std::span<T> grad)
+{
+    if constexpr (F == RELU)
+        ReluDerivativeBatch(out, grad);
+    else if constexpr (F == TANH)
+        TanhDerivativeBatch(out, grad);
+    else if constexpr (F == SIGMOID)
+        SigmoidDerivativeBatch(out, grad);
+    else
+        LinearDerivativeBatch(out, grad); // SOFTMAX too, the cross-entropy gradient already is p - y
+}
+
+// name of the selected implementation, "avx512", "avx2" or "scalar"
+const char *ActivationKernelName();
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef ALIGNEDBUFFER_H
+#define ALIGNEDBUFFER_H
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+
+// cache line size, every buffer (and every padded matrix row) starts on this boundary
+constexpr std::size_t CACHE_LINE = 64U;
+
+// round a row length up so that consecutive rows stay cache line aligned
+template <typename T>
+constexpr std::size_t PaddedStride(std::size_t cols)
+{
+    constexpr std::size_t perLine = CACHE_LINE / sizeof(T);
+    return (cols + perLine - 1) / perLine * perLine;
+}
+
+/* @brief
+ *   Owning, zero initialised and cache line aligned contiguous buffer
+ *   Only meant for trivial types (double, float, int ...)
+ *   Borrow() makes it a view of memory owned elsewhere (an Arena), which it never frees
+ */
+template <typename T>
+class AlignedBuffer
+{
+public:
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(std::size_t count) { Resize(count); }
+
+    // discard the old content, new content is zeroed
+    void Resize(std::size_t count)
+    {
+        m_data.reset(count ? static_cast<T *>(::operator new[](count * sizeof(T), std::align_val_t(CACHE_LINE))) : nullptr);
+        m_size = count;
+        if (count)
+            std::memset(m_data.get(), 0, count * sizeof(T));
+    }
+    // use count elements of data, which has to stay alive (and aligned) as long as this buffer
+    void Borrow(T *data, std::size_t count)
+    {
+        m_data = std::unique_ptr<T[], Deleter>(data, Deleter{false});
+        m_size = count;
+    }
+
+    inline T *data() { return m_data.get(); }
+    inline const T *data() const { return m_data.get(); }
+    inline std::size_t size() const { return m_size; }
+    inline bool empty() const { return m_size == 0; }
+    inline T &operator[](std::size_t i) { return m_data[i]; }
+    inline const T &operator[](std::size_t i) const { return m_data[i]; }
+    inline T *begin() { return data(); }
+    inline T *end() { return data() + m_size; }
+    inline const T *begin() const { return data(); }
+    inline const T *end() const { return data() + m_size; }
+
+private:
+    struct Deleter
+    {
+        bool isOwner = true; // false for borrowed memory
+        void operator()(T *p) const
+        {
+            if (isOwner)
+                ::operator delete[](p, std::align_val_t(CACHE_LINE));
+        }
+    };
+    std::unique_ptr<T[], Deleter> m_data = nullptr;
+    std::size_t m_size = 0U;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "AllocationCounter.hpp"
+
+// replaces the global operator new of whatever links this file in, the array and nothrow
+// forms of the standard library forward to these
+static std::atomic<std::uint64_t> s_bytes{0U};
+static std::atomic<std::uint64_t> s_allocations{0U};
+static thread_local std::uint64_t t_allocations = 0U;
+
+static void *CountedAlloc(std::size_t size, std::size_t alignment)
+{
+    s_bytes.fetch_add(size, std::memory_order_relaxed);
+    s_allocations.fetch_add(1U, std::memory_order_relaxed);
+    ++t_allocations;
+    void *p = (alignment > alignof(std::max_align_t)) ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                                                      : std::malloc(size ? size : 1U);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(std::size_t size) { return CountedAlloc(size, alignof(std::max_align_t)); }
+void *operator new(std::size_t size, std::align_val_t alignment) { return CountedAlloc(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+std::uint64_t HeapAllocations() { return s_allocations.load(std::memory_order_relaxed); }
+std::uint64_t HeapBytes() { return s_bytes.load(std::memory_order_relaxed); }
+std::uint64_t ThreadHeapAllocations() { return t_allocations; }
+void UncountThreadHeapAllocations(std::uint64_t count) { t_allocations -= count; }
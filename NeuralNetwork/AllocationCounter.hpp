@@ -0,0 +1,49 @@
+#pragma once
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <atomic>
+#include <cstdint>
+
+// heap allocations and bytes since startup, all threads, counted by the operator new of AllocationCounter.cpp
+std::uint64_t HeapAllocations();
+std::uint64_t HeapBytes();
+// heap allocations of the calling thread only
+std::uint64_t ThreadHeapAllocations();
+// take count allocations of the calling thread back out of ThreadHeapAllocations(), for instrumentation
+// (the profiler's own buffers) that must not show up in the scope it happens to run in
+void UncountThreadHeapAllocations(std::uint64_t count);
+
+#ifdef SNN_COUNT_ALLOCATIONS
+
+/* @brief
+ *   Debug check that the hot path does not allocate, compiled in with -DSNN_COUNT_ALLOCATIONS
+ *   (on by default in Debug builds) which also links the counting operator new into the program
+ *   Adds the allocations the current thread made while the scope was alive to total,
+ *   other threads (reporter, validator) do not show up, so every worker of a step needs its own scope
+ *   Without SNN_COUNT_ALLOCATIONS the macro expands to nothing
+ */
+class AllocationScope
+{
+public:
+    explicit AllocationScope(std::atomic<std::uint64_t> &total) : m_total(total), m_start(ThreadHeapAllocations()) {}
+    ~AllocationScope() { m_total.fetch_add(ThreadHeapAllocations() - m_start, std::memory_order_relaxed); }
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope &operator=(const AllocationScope &) = delete;
+
+private:
+    std::atomic<std::uint64_t> &m_total;
+    std::uint64_t m_start;
+};
+
+#define ALLOCATION_CONCAT_(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_(a, b)
+#define COUNT_ALLOCATIONS(total) AllocationScope ALLOCATION_CONCAT(allocationScope, __LINE__)(total)
+
+#else
+
+#define COUNT_ALLOCATIONS(total) ((void)0)
+
+#endif
+
+#endif
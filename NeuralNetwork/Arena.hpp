@@ -0,0 +1,70 @@
+#pragma once
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include "AlignedBuffer.hpp"
+
+/* @brief
+ *   One zeroed, cache line aligned block a whole model carves its buffers out of
+ *   Sized up front (sum the Footprint() of every buffer), then Allocate() just bumps an offset
+ *   Nothing is freed on its own, the block goes away with the arena or the next Reserve(),
+ *   so every buffer taken from it has to be dropped before that
+ */
+class Arena
+{
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // bytes Allocate<T>(count) takes out of the arena, padding to the next cache line included
+    template <typename T>
+    static constexpr std::size_t Footprint(std::size_t count)
+    {
+        return (count * sizeof(T) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    }
+
+    // drop the old block and take a new zeroed one of bytes
+    void Reserve(std::size_t bytes)
+    {
+        m_block.Resize(bytes);
+        m_used = 0U;
+    }
+
+    // count zeroed elements starting on a cache line
+    template <typename T>
+    T *Allocate(std::size_t count)
+    {
+        const std::size_t bytes = Footprint<T>(count);
+        if (m_used + bytes > m_block.size())
+        {
+            std::cerr << "Arena exhausted! Capacity " << m_block.size() << " Bytes, Requested " << m_used + bytes << "." << std::endl;
+            exit(-1);
+        }
+        T *p = reinterpret_cast<T *>(m_block.data() + m_used);
+        m_used += bytes;
+        return p;
+    }
+
+    inline std::size_t Capacity() const { return m_block.size(); }
+    inline std::size_t Used() const { return m_used; }
+
+private:
+    AlignedBuffer<unsigned char> m_block;
+    std::size_t m_used = 0U;
+};
+
+// buffer of count elements out of arena, or its own heap block when there is no arena
+template <typename T>
+inline void AllocateBuffer(AlignedBuffer<T> &buffer, std::size_t count, Arena *arena)
+{
+    if (arena == nullptr)
+        buffer.Resize(count);
+    else
+        buffer.Borrow(count ? arena->Allocate<T>(count) : nullptr, count);
+}
+
+#endif
@@ -0,0 +1,514 @@
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "Gemm.hpp"
+#include "KernelDispatch.hpp"
+
+// the vector kernels use GNU vector extensions (vector_size, __builtin_shuffle)
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define NN_X86_DISPATCH 1
+#pragma GCC diagnostic ignored "-Wpsabi" // vectors never cross an ABI boundary, every kernel below is inlined
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+// the kernel templates are only instantiated inside the target specific wrappers below,
+// so they have to be inlined there to be compiled for that instruction set
+#define GEMM_INLINE __attribute__((always_inline)) inline
+#else
+#define GEMM_INLINE inline
+#endif
+
+namespace
+{
+    // fewer rows of C than this read B in place even when given a pack buffer
+    constexpr std::size_t GEMM_MIN_PACKED_ROWS = 4;
+
+    // element (r, c) at data[r * rs + c * cs], one blocked driver serves every transpose
+    template <typename T>
+    struct Operand
+    {
+        const T *data;
+        std::size_t rs;
+        std::size_t cs;
+
+        inline T operator()(std::size_t r, std::size_t c) const { return data[r * rs + c * cs]; }
+        inline Operand Offset(std::size_t r, std::size_t c) const { return {data + r * rs + c * cs, rs, cs}; }
+    };
+
+    // the kernels below are written once for V = T (scalar) and V = a GNU vector of T,
+    // loads and stores go through memcpy (unaligned), x - V{} broadcasts x (x - 0 folds away, x + 0 does not)
+    // nothing vector valued is passed to a nested helper by value or reference, such a helper would be
+    // compiled for the default target before it is inlined into the target specific wrapper
+    template <typename T, typename V>
+    constexpr std::size_t LANES = sizeof(V) / sizeof(T);
+
+    // MR x NR tile of C (NR = NV vectors) from an MR wide micro-panel of A and an NR wide micro-panel of B,
+    // both k-major, the MR * NV accumulators live in registers for the whole k loop
+    template <typename T, typename V, std::size_t MR, std::size_t NV>
+    GEMM_INLINE void MicroKernel(std::size_t kc, const T *a, const T *b, T *c, std::size_t ldc, T beta)
+    {
+        constexpr std::size_t W = LANES<T, V>, NR = NV * W;
+        V acc[MR][NV];
+#pragma GCC unroll 16
+        for (std::size_t i = 0; i < MR; ++i)
+#pragma GCC unroll 4
+            for (std::size_t v = 0; v < NV; ++v)
+                acc[i][v] = V{};
+        for (std::size_t k = 0; k < kc; ++k, a += MR, b += NR)
+        {
+            V bv[NV];
+#pragma GCC unroll 4
+            for (std::size_t v = 0; v < NV; ++v)
+                std::memcpy(&bv[v], b + v * W, sizeof(V));
+#pragma GCC unroll 16
+            for (std::size_t i = 0; i < MR; ++i)
+            {
+                const V ai = a[i] - V{};
+#pragma GCC unroll 4
+                for (std::size_t v = 0; v < NV; ++v)
+                    acc[i][v] += ai * bv[v];
+            }
+        }
+#pragma GCC unroll 16
+        for (std::size_t i = 0; i < MR; ++i)
+#pragma GCC unroll 4
+            for (std::size_t v = 0; v < NV; ++v)
+            {
+                T *p = c + i * ldc + v * W;
+                if (beta != 0)
+                {
+                    V old;
+                    std::memcpy(&old, p, sizeof(V));
+                    acc[i][v] += (beta - V{}) * old;
+                }
+                std::memcpy(p, &acc[i][v], sizeof(V));
+            }
+    }
+
+    // MR x NR tile of C as dot products of MR rows of A with NR rows of B, both read in place along k,
+    // every loaded vector of A is shared by NR products and every vector of B by MR
+    template <typename T, typename V, std::size_t MR, std::size_t NR>
+    GEMM_INLINE void DotTile(std::size_t K, const T *A, std::size_t lda, const T *B, std::size_t ldb, T *C, std::size_t ldc, T beta)
+    {
+        constexpr std::size_t W = LANES<T, V>;
+        V acc[MR][NR];
+#pragma GCC unroll 4
+        for (std::size_t i = 0; i < MR; ++i)
+#pragma GCC unroll 4
+            for (std::size_t j = 0; j < NR; ++j)
+                acc[i][j] = V{};
+        std::size_t k = 0;
+        for (; k + W <= K; k += W)
+        {
+            V a[MR], b[NR];
+#pragma GCC unroll 4
+            for (std::size_t i = 0; i < MR; ++i)
+                std::memcpy(&a[i], A + i * lda + k, sizeof(V));
+#pragma GCC unroll 4
+            for (std::size_t j = 0; j < NR; ++j)
+                std::memcpy(&b[j], B + j * ldb + k, sizeof(V));
+#pragma GCC unroll 4
+            for (std::size_t i = 0; i < MR; ++i)
+#pragma GCC unroll 4
+                for (std::size_t j = 0; j < NR; ++j)
+                    acc[i][j] += a[i] * b[j];
+        }
+        for (std::size_t i = 0; i < MR; ++i)
+            for (std::size_t j = 0; j < NR; ++j)
+            {
+                T lanes[W];
+                std::memcpy(lanes, &acc[i][j], sizeof(V));
+                T sum = 0;
+                for (std::size_t l = 0; l < W; ++l)
+                    sum += lanes[l];
+                for (std::size_t kk = k; kk < K; ++kk)
+                    sum += A[i * lda + kk] * B[j * ldb + kk];
+                T &c = C[i * ldc + j];
+                c = (beta == 0) ? sum : sum + beta * c;
+            }
+    }
+
+    // C = A * B^T + beta * C with both operands read in place along k, for a few rows of A
+    // (a single sample) where packing B would cost more than it saves
+    template <typename T, typename V, std::size_t MR, std::size_t NR>
+    GEMM_INLINE void DotProducts(std::size_t M, std::size_t N, std::size_t K, const T *A, std::size_t lda, const T *B, std::size_t ldb,
+                                 T *C, std::size_t ldc, T beta)
+    {
+        std::size_t i = 0;
+        for (; i + MR <= M; i += MR)
+        {
+            std::size_t j = 0;
+            for (; j + NR <= N; j += NR)
+                DotTile<T, V, MR, NR>(K, A + i * lda, lda, B + j * ldb, ldb, C + i * ldc + j, ldc, beta);
+            for (; j < N; ++j)
+                DotTile<T, V, MR, 1>(K, A + i * lda, lda, B + j * ldb, ldb, C + i * ldc + j, ldc, beta);
+        }
+        for (; i < M; ++i)
+        {
+            std::size_t j = 0;
+            for (; j + NR <= N; j += NR)
+                DotTile<T, V, 1, NR>(K, A + i * lda, lda, B + j * ldb, ldb, C + i * ldc + j, ldc, beta);
+            for (; j < N; ++j)
+                DotTile<T, V, 1, 1>(K, A + i * lda, lda, B + j * ldb, ldb, C + i * ldc + j, ldc, beta);
+        }
+    }
+
+    // NV vectors of c held in registers while every row of B is added in
+    template <typename T, typename V, std::size_t NV>
+    GEMM_INLINE void AxpyBlock(std::size_t K, const T *a, std::size_t inc, const T *B, std::size_t ldb, T *c, T beta)
+    {
+        constexpr std::size_t W = LANES<T, V>;
+        V acc[NV];
+#pragma GCC unroll 4
+        for (std::size_t v = 0; v < NV; ++v)
+            acc[v] = V{};
+        for (std::size_t k = 0; k < K; ++k)
+        {
+            const V ak = a[k * inc] - V{};
+#pragma GCC unroll 4
+            for (std::size_t v = 0; v < NV; ++v)
+            {
+                V y;
+                std::memcpy(&y, B + k * ldb + v * W, sizeof(V));
+                acc[v] += ak * y;
+            }
+        }
+#pragma GCC unroll 4
+        for (std::size_t v = 0; v < NV; ++v)
+        {
+            if (beta != 0)
+            {
+                V old;
+                std::memcpy(&old, c + v * W, sizeof(V));
+                acc[v] += (beta - V{}) * old;
+            }
+            std::memcpy(c + v * W, &acc[v], sizeof(V));
+        }
+    }
+
+    // c = a * B + beta * c for one row a (element k at a[k * inc]), B read in place (K x N)
+    template <typename T, typename V>
+    GEMM_INLINE void AxpyRows(std::size_t N, std::size_t K, const T *a, std::size_t inc, const T *B, std::size_t ldb, T *c, T beta)
+    {
+        constexpr std::size_t W = LANES<T, V>;
+        std::size_t j = 0;
+        for (; j + 4 * W <= N; j += 4 * W)
+            AxpyBlock<T, V, 4>(K, a, inc, B + j, ldb, c + j, beta);
+        for (; j + W <= N; j += W)
+            AxpyBlock<T, V, 1>(K, a, inc, B + j, ldb, c + j, beta);
+        for (; j < N; ++j)
+            AxpyBlock<T, T, 1>(K, a, inc, B + j, ldb, c + j, beta);
+    }
+
+    // kc x cols block of B^T (element (k, c) at B[c * ldb + k]) into one nr wide k-major micro-panel, scalar
+    template <typename T>
+    GEMM_INLINE void TransposeScalar(std::size_t kc, std::size_t cols, const T *B, std::size_t ldb, std::size_t nr, T *pack)
+    {
+        for (std::size_t c = 0; c < cols; ++c)
+            for (std::size_t k = 0; k < kc; ++k)
+                pack[k * nr + c] = B[c * ldb + k];
+    }
+
+#ifdef NN_X86_DISPATCH
+    // one round of a W x W transpose held in W registers (row r in x[r], column c in lane c):
+    // the off-diagonal S x S sub-blocks of every 2S x 2S block swap places, log2(W) rounds in all
+    template <typename T, typename V, std::size_t S, std::size_t... C>
+    GEMM_INLINE void TransposeRound(V *x, std::index_sequence<C...> lanes)
+    {
+        constexpr std::size_t W = sizeof...(C);
+        using I = std::conditional_t<sizeof(T) == 4, std::int32_t, std::int64_t>;
+        typedef I Mask __attribute__((vector_size(sizeof(V))));
+        constexpr Mask lo = {static_cast<I>((C & S) ? W + C - S : C)...};
+        constexpr Mask hi = {static_cast<I>((C & S) ? W + C : C + S)...};
+#pragma GCC unroll 16
+        for (std::size_t r = 0; r < W; ++r)
+            if ((r & S) == 0)
+            {
+                const V a = x[r], b = x[r + S];
+                x[r] = __builtin_shuffle(a, b, lo);
+                x[r + S] = __builtin_shuffle(a, b, hi);
+            }
+        if constexpr (S > 1)
+            TransposeRound<T, V, S / 2>(x, lanes);
+    }
+
+    // TransposeScalar a W x W block at a time through registers, this is the packing the forward pass
+    // X * W^T needs every step, scalar it would cost about as much as the product itself
+    template <typename T, typename V>
+    GEMM_INLINE void TransposePanel(std::size_t kc, std::size_t cols, const T *B, std::size_t ldb, std::size_t nr, T *pack)
+    {
+        constexpr std::size_t W = LANES<T, V>;
+        std::size_t c = 0;
+        for (; c + W <= cols; c += W)
+        {
+            std::size_t k = 0;
+            for (; k + W <= kc; k += W)
+            {
+                V x[W];
+#pragma GCC unroll 16
+                for (std::size_t r = 0; r < W; ++r)
+                    std::memcpy(&x[r], B + (c + r) * ldb + k, sizeof(V));
+                TransposeRound<T, V, W / 2>(x, std::make_index_sequence<W>{});
+#pragma GCC unroll 16
+                for (std::size_t r = 0; r < W; ++r)
+                    std::memcpy(pack + (k + r) * nr + c, &x[r], sizeof(V));
+            }
+            for (; k < kc; ++k)
+                for (std::size_t r = 0; r < W; ++r)
+                    pack[k * nr + c + r] = B[(c + r) * ldb + k];
+        }
+        TransposeScalar(kc, cols - c, B + c * ldb, ldb, nr, pack + c);
+    }
+#endif
+
+    template <typename T>
+    struct KernelTable
+    {
+        void (*micro)(std::size_t kc, const T *a, const T *b, T *c, std::size_t ldc, T beta);
+        void (*transpose)(std::size_t kc, std::size_t cols, const T *B, std::size_t ldb, std::size_t nr, T *pack);
+        void (*dot)(std::size_t M, std::size_t N, std::size_t K, const T *A, std::size_t lda, const T *B, std::size_t ldb, T *C,
+                    std::size_t ldc, T beta);
+        void (*axpy)(std::size_t N, std::size_t K, const T *a, std::size_t inc, const T *B, std::size_t ldb, T *c, T beta);
+        std::size_t mr;
+        std::size_t nr;
+        const char *name;
+    };
+
+// one set of kernels for an instruction set and scalar type, MR x NV vectors packed tiles, DR x DN dot tiles
+#define GEMM_KERNELS(ISA, TARGET, T, V, MR, NV, DR, DN, TRANSPOSE)                                                   \
+    TARGET void Micro##ISA(std::size_t kc, const T *a, const T *b, T *c, std::size_t ldc, T beta)                    \
+    {                                                                                                                \
+        MicroKernel<T, V, MR, NV>(kc, a, b, c, ldc, beta);                                                           \
+    }                                                                                                                \
+    TARGET void Transpose##ISA(std::size_t kc, std::size_t cols, const T *B, std::size_t ldb, std::size_t nr, T *pack) \
+    {                                                                                                                \
+        TRANSPOSE(kc, cols, B, ldb, nr, pack);                                                                       \
+    }                                                                                                                \
+    TARGET void Dot##ISA(std::size_t M, std::size_t N, std::size_t K, const T *A, std::size_t lda, const T *B,       \
+                         std::size_t ldb, T *C, std::size_t ldc, T beta)                                             \
+    {                                                                                                                \
+        DotProducts<T, V, DR, DN>(M, N, K, A, lda, B, ldb, C, ldc, beta);                                            \
+    }                                                                                                                \
+    TARGET void Axpy##ISA(std::size_t N, std::size_t K, const T *a, std::size_t inc, const T *B, std::size_t ldb, T *c, \
+                          T beta)                                                                                    \
+    {                                                                                                                \
+        AxpyRows<T, V>(N, K, a, inc, B, ldb, c, beta);                                                               \
+    }
+
+    GEMM_KERNELS(Scalar, , float, float, 4, 4, 2, 2, TransposeScalar<float>)
+    GEMM_KERNELS(Scalar, , double, double, 4, 4, 2, 2, TransposeScalar<double>)
+
+#ifdef NN_X86_DISPATCH
+    template <typename T, std::size_t BYTES>
+    struct VecOf
+    {
+        typedef T type __attribute__((vector_size(BYTES)));
+    };
+    using Float8 = VecOf<float, 32>::type;
+    using Double4 = VecOf<double, 32>::type;
+    using Float16 = VecOf<float, 64>::type;
+    using Double8 = VecOf<double, 64>::type;
+
+    // 16 registers: 6 x 2 accumulators, 2 for B and 1 for the broadcast of A, dot tiles of 2 x 4
+    GEMM_KERNELS(Avx2, __attribute__((target("avx2,fma"))), float, Float8, 6, 2, 2, 4, (TransposePanel<float, Float8>))
+    GEMM_KERNELS(Avx2, __attribute__((target("avx2,fma"))), double, Double4, 6, 2, 2, 4, (TransposePanel<double, Double4>))
+    // 32 registers: 8 x 3 accumulators, 3 for B and 1 for the broadcast of A, dot tiles of 4 x 4
+    GEMM_KERNELS(Avx512, __attribute__((target("avx512f"))), float, Float16, 8, 3, 4, 4, (TransposePanel<float, Float16>))
+    GEMM_KERNELS(Avx512, __attribute__((target("avx512f"))), double, Double8, 8, 3, 4, 4, (TransposePanel<double, Double8>))
+#endif
+
+    template <typename T>
+    KernelTable<T> SelectKernels()
+    {
+#ifdef NN_X86_DISPATCH
+        __builtin_cpu_init();
+        if (IsaAllowed(ISA_AVX512) && __builtin_cpu_supports("avx512f"))
+            return {MicroAvx512, TransposeAvx512, DotAvx512, AxpyAvx512, 8, 192 / sizeof(T), "avx512f"};
+        if (IsaAllowed(ISA_AVX2) && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return {MicroAvx2, TransposeAvx2, DotAvx2, AxpyAvx2, 6, 64 / sizeof(T), "avx2"};
+#endif
+        return {MicroScalar, TransposeScalar, DotScalar, AxpyScalar, 4, 4, "scalar"};
+    }
+
+    // resolved once, on first use
+    template <typename T>
+    const KernelTable<T> &Kernels()
+    {
+        static const KernelTable<T> table = SelectKernels<T>();
+        return table;
+    }
+
+    // rows [0, mc) x columns [0, kc) of A as mr high k-major micro-panels, the last one zero padded
+    template <typename T>
+    void PackA(std::size_t mc, std::size_t kc, Operand<T> A, std::size_t mr, T *pack)
+    {
+        for (std::size_t i = 0; i < mc; i += mr, pack += mr * kc)
+        {
+            const std::size_t rows = std::min(mr, mc - i);
+            // walk A along whichever direction is contiguous
+            if (A.cs == 1)
+            {
+                for (std::size_t r = 0; r < rows; ++r)
+                    for (std::size_t k = 0; k < kc; ++k)
+                        pack[k * mr + r] = A(i + r, k);
+            }
+            else
+            {
+                for (std::size_t k = 0; k < kc; ++k)
+                    for (std::size_t r = 0; r < rows; ++r)
+                        pack[k * mr + r] = A(i + r, k);
+            }
+            for (std::size_t k = 0; k < kc && rows < mr; ++k)
+                std::fill(pack + k * mr + rows, pack + (k + 1) * mr, T(0));
+        }
+    }
+
+    // rows [0, kc) x columns [0, nc) of B as nr wide k-major micro-panels, the last one zero padded
+    template <typename T>
+    void PackB(std::size_t kc, std::size_t nc, Operand<T> B, std::size_t nr, T *pack)
+    {
+        for (std::size_t j = 0; j < nc; j += nr, pack += nr * kc)
+        {
+            const std::size_t cols = std::min(nr, nc - j);
+            if (B.cs == 1)
+            {
+                for (std::size_t k = 0; k < kc; ++k)
+                    std::copy(B.data + k * B.rs + j, B.data + k * B.rs + j + cols, pack + k * nr);
+            }
+            else // B^T of a row-major matrix, the weights in the forward pass
+                Kernels<T>().transpose(kc, cols, B.data + j * B.cs, B.cs, nr, pack);
+            for (std::size_t k = 0; k < kc && cols < nr; ++k)
+                std::fill(pack + k * nr + cols, pack + (k + 1) * nr, T(0));
+        }
+    }
+
+    // epilogue over rows x cols of C starting at (row, col)
+    template <typename T>
+    inline void Finish(const GemmEpilogue<T> &epilogue, T *C, std::size_t ldc, std::size_t row, std::size_t col, std::size_t rows, std::size_t cols)
+    {
+        for (std::size_t r = row; r < row + rows; ++r)
+        {
+            T *c = C + r * ldc + col;
+            if (epilogue.bias != nullptr)
+                for (std::size_t j = 0; j < cols; ++j)
+                    c[j] += epilogue.biasScale * epilogue.bias[col + j];
+            if (epilogue.apply != nullptr)
+                epilogue.apply(c, epilogue.aux != nullptr ? epilogue.aux + r * epilogue.ldaux + col : nullptr, cols);
+        }
+    }
+
+    // C = A * B + beta * C over packed KC x NC blocks of B and MC x KC blocks of A
+    template <typename T>
+    void Blocked(std::size_t M, std::size_t N, std::size_t K, Operand<T> A, Operand<T> B, T *C, std::size_t ldc, T beta, T *pack,
+                 const GemmEpilogue<T> &epilogue)
+    {
+        if (K == 0)
+        {
+            // nothing to multiply, only the scaling of C is left
+            for (std::size_t i = 0; i < M; ++i)
+                for (std::size_t j = 0; j < N; ++j)
+                    C[i * ldc + j] = (beta == 0) ? T(0) : beta * C[i * ldc + j];
+            if (!epilogue.empty())
+                Finish(epilogue, C, ldc, 0, 0, M, N);
+            return;
+        }
+        const KernelTable<T> &kernels = Kernels<T>();
+        const std::size_t mr = kernels.mr, nr = kernels.nr;
+        T *packA = pack;
+        T *packB = pack + GemmPackASize(M, K);
+        alignas(64) T tile[GEMM_MAX_MR * GEMM_MAX_NR<T>]; // edge tiles are computed here, then merged into C
+        for (std::size_t jc = 0; jc < N; jc += GEMM_NC)
+        {
+            const std::size_t nc = std::min(GEMM_NC, N - jc);
+            for (std::size_t pc = 0; pc < K; pc += GEMM_KC)
+            {
+                const std::size_t kc = std::min(GEMM_KC, K - pc);
+                const T b = (pc == 0) ? beta : T(1); // later blocks of K add to the first
+                const bool last = (pc + kc == K) && !epilogue.empty();
+                PackB(kc, nc, B.Offset(pc, jc), nr, packB);
+                for (std::size_t ic = 0; ic < M; ic += GEMM_MC)
+                {
+                    const std::size_t mc = std::min(GEMM_MC, M - ic);
+                    PackA(mc, kc, A.Offset(ic, pc), mr, packA);
+                    // a micro-panel of B stays in L1 while every micro-panel of A passes it
+                    for (std::size_t jr = 0; jr < nc; jr += nr)
+                    {
+                        const std::size_t cols = std::min(nr, nc - jr);
+                        for (std::size_t ir = 0; ir < mc; ir += mr)
+                        {
+                            const std::size_t rows = std::min(mr, mc - ir);
+                            T *c = C + (ic + ir) * ldc + jc + jr;
+                            if (rows == mr && cols == nr)
+                                kernels.micro(kc, packA + ir * kc, packB + jr * kc, c, ldc, b);
+                            else
+                            {
+                                kernels.micro(kc, packA + ir * kc, packB + jr * kc, tile, nr, T(0));
+                                for (std::size_t r = 0; r < rows; ++r)
+                                    for (std::size_t col = 0; col < cols; ++col)
+                                        c[r * ldc + col] = (b == 0) ? tile[r * nr + col] : tile[r * nr + col] + b * c[r * ldc + col];
+                            }
+                            if (last)
+                                Finish(epilogue, C, ldc, ic + ir, jc + jr, rows, cols);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void GemmABt(std::size_t M, std::size_t N, std::size_t K,
+             const T *A, std::size_t lda, const T *B, std::size_t ldb,
+             T *C, std::size_t ldc, T beta, T *pack, GemmEpilogue<T> epilogue)
+{
+    // packing W pays off once a few rows share every panel of it, a ragged last batch may be smaller
+    if (pack != nullptr && M >= GEMM_MIN_PACKED_ROWS)
+        return Blocked<T>(M, N, K, {A, lda, 1}, {B, 1, ldb}, C, ldc, beta, pack, epilogue);
+    // both operands are walked along their rows, so each entry is a contiguous dot product
+    Kernels<T>().dot(M, N, K, A, lda, B, ldb, C, ldc, beta);
+    if (!epilogue.empty())
+        Finish(epilogue, C, ldc, 0, 0, M, N);
+}
+
+template <typename T>
+void GemmAB(std::size_t M, std::size_t N, std::size_t K,
+            const T *A, std::size_t lda, const T *B, std::size_t ldb,
+            T *C, std::size_t ldc, T beta, T *pack, GemmEpilogue<T> epilogue)
+{
+    if (pack != nullptr && M >= GEMM_MIN_PACKED_ROWS)
+        return Blocked<T>(M, N, K, {A, lda, 1}, {B, ldb, 1}, C, ldc, beta, pack, epilogue);
+    // every row of C is a sum of rows of B, weighted by a row of A
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        Kernels<T>().axpy(N, K, A + i * lda, 1, B, ldb, C + i * ldc, beta);
+        if (!epilogue.empty())
+            Finish(epilogue, C, ldc, i, 0, 1, N);
+    }
+}
+
+template <typename T>
+void GemmAtB(std::size_t M, std::size_t N, std::size_t K,
+             const T *A, std::size_t lda, const T *B, std::size_t ldb,
+             T *C, std::size_t ldc, T beta, T *pack)
+{
+    if (pack != nullptr)
+        return Blocked<T>(M, N, K, {A, 1, lda}, {B, ldb, 1}, C, ldc, beta, pack, {});
+    // same as GemmAB with a column of A as the weights
+    for (std::size_t i = 0; i < M; ++i)
+        Kernels<T>().axpy(N, K, A + i, lda, B, ldb, C + i * ldc, beta);
+}
+
+const char *GemmKernelName() { return Kernels<float>().name; }
+
+#define INSTANTIATE_GEMM(T)                                                                               \
+    template void GemmABt<T>(std::size_t, std::size_t, std::size_t, const T *, std::size_t, const T *,   \
+                             std::size_t, T *, std::size_t, T, T *, GemmEpilogue<T>);                    \
+    template void GemmAB<T>(std::size_t, std::size_t, std::size_t, const T *, std::size_t, const T *,    \
+                            std::size_t, T *, std::size_t, T, T *, GemmEpilogue<T>);                     \
+    template void GemmAtB<T>(std::size_t, std::size_t, std::size_t, const T *, std::size_t, const T *,   \
+                             std::size_t, T *, std::size_t, T, T *);
+
+INSTANTIATE_GEMM(float)
+INSTANTIATE_GEMM(double)
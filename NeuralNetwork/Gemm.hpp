@@ -0,0 +1,89 @@
+#pragma once
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <algorithm>
+#include <cstddef>
+
+// Row-major matrix multiply kernels used by the forward/backward passes
+// M x N is the shape of C, K the shared dimension, ld* the row stride of each matrix
+// beta = 0 overwrites C, beta = 1 accumulates into C
+// instantiated for float and double, accumulation happens in the matrix type
+//
+// With a pack buffer of GemmPackSize<T>(M, N, K) elements the product is cache blocked:
+// KC x NC blocks of B and MC x KC blocks of A are copied into contiguous micro-panels,
+// a KC x NR panel of B stays in L1 and the MC x KC block of A in L2 while a register blocked
+// MR x NR microkernel (AVX-512, AVX2 or scalar, picked at runtime) sweeps over them.
+// Without one (pack = nullptr) the operands are read in place, which is what a single sample
+// (M = 1) wants, there is no reuse to pay a copy for.
+//
+// An epilogue runs on every finished tile of C right after the microkernel stored it, while it
+// is still in L1, instead of as a second pass over all of C once the product is done.
+
+// cache blocking, in elements of the shared dimension (KC) and of the rows/columns of C (MC, NC)
+constexpr std::size_t GEMM_KC = 256;
+constexpr std::size_t GEMM_MC = 256;
+constexpr std::size_t GEMM_NC = 4096;
+// largest microkernel tile of any instruction set, the edge tile buffer is sized for it
+constexpr std::size_t GEMM_MAX_MR = 8;
+// the packed block of A is padded to a multiple of every kernel's MR (4, 6 and 8), so the
+// panels of whichever kernel was picked fit in front of the packed block of B
+constexpr std::size_t GEMM_PACK_MR = 24;
+static_assert(GEMM_PACK_MR % 4 == 0 && GEMM_PACK_MR % 6 == 0 && GEMM_PACK_MR % 8 == 0, "GEMM_PACK_MR has to be a multiple of every MR");
+template <typename T>
+constexpr std::size_t GEMM_MAX_NR = 192 / sizeof(T); // three 64-byte vectors
+
+// elements of the pack buffer the packed block of A takes, the packed block of B starts behind it
+constexpr std::size_t GemmPackASize(std::size_t M, std::size_t K)
+{
+    return (std::min(M, GEMM_MC) + GEMM_PACK_MR - 1) / GEMM_PACK_MR * GEMM_PACK_MR * std::min(K, GEMM_KC);
+}
+
+// elements of pack buffer the blocked product of an M x N x K problem needs
+template <typename T>
+constexpr std::size_t GemmPackSize(std::size_t M, std::size_t N, std::size_t K)
+{
+    auto roundUp = [](std::size_t n, std::size_t to)
+    { return (n + to - 1) / to * to; };
+    const std::size_t kc = std::min(K, GEMM_KC);
+    return GemmPackASize(M, K) + kc * roundUp(std::min(N, GEMM_NC), GEMM_MAX_NR<T>);
+}
+
+// element wise step applied to C once the product is final (bias, activation, derivative scaling)
+// biasScale * bias[j] is added to column j of every row first, when there is a bias
+// apply(c, aux, n) then gets n consecutive entries of a row of C and the matching entries of aux,
+// aux is an optional second matrix laid out like C (nullptr when not given)
+template <typename T>
+struct GemmEpilogue
+{
+    void (*apply)(T *c, T *aux, std::size_t n) = nullptr;
+    T *aux = nullptr;
+    std::size_t ldaux = 0U;
+    const T *bias = nullptr;
+    T biasScale = 1;
+
+    inline bool empty() const { return apply == nullptr && bias == nullptr; }
+};
+
+// C = A * B^T + beta * C    (A is M x K, B is N x K), layer forward pass X * W^T
+template <typename T>
+void GemmABt(std::size_t M, std::size_t N, std::size_t K,
+             const T *A, std::size_t lda, const T *B, std::size_t ldb,
+             T *C, std::size_t ldc, T beta = 0, T *pack = nullptr, GemmEpilogue<T> epilogue = {});
+
+// C = A * B + beta * C      (A is M x K, B is K x N), hidden gradient delta * W
+template <typename T>
+void GemmAB(std::size_t M, std::size_t N, std::size_t K,
+            const T *A, std::size_t lda, const T *B, std::size_t ldb,
+            T *C, std::size_t ldc, T beta = 0, T *pack = nullptr, GemmEpilogue<T> epilogue = {});
+
+// C = A^T * B + beta * C    (A is K x M, B is K x N), weight gradient delta^T * X
+template <typename T>
+void GemmAtB(std::size_t M, std::size_t N, std::size_t K,
+             const T *A, std::size_t lda, const T *B, std::size_t ldb,
+             T *C, std::size_t ldc, T beta = 0, T *pack = nullptr);
+
+// instruction set of the selected microkernels, for logs and benchmarks
+const char *GemmKernelName();
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef KERNELDISPATCH_H
+#define KERNELDISPATCH_H
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// instruction sets the kernels are dispatched between at runtime
+enum ISA_LEVEL
+{
+    ISA_SCALAR = 0,
+    ISA_AVX2,
+    ISA_AVX512
+};
+
+// highest instruction set the dispatch may pick, read once from the environment
+// SNN_ISA=scalar|avx2|avx512 caps it below what the CPU supports, so every implementation
+// can be run and checked on one machine (bench --verify), unset leaves the CPU features in charge
+inline ISA_LEVEL IsaCap()
+{
+    static const ISA_LEVEL cap = []()
+    {
+        const char *isa = std::getenv("SNN_ISA");
+        if (isa == nullptr || *isa == '\0' || std::strcmp(isa, "avx512") == 0)
+            return ISA_AVX512;
+        if (std::strcmp(isa, "avx2") == 0)
+            return ISA_AVX2;
+        if (std::strcmp(isa, "scalar") == 0)
+            return ISA_SCALAR;
+        std::cerr << "SNN_ISA not recognized!" << std::endl;
+        exit(-1);
+    }();
+    return cap;
+}
+
+inline bool IsaAllowed(ISA_LEVEL level)
+{
+    return level <= IsaCap();
+}
+
+#endif
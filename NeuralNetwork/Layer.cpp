@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include "Layer.hpp"
+#include "ActivationKernels.hpp"
+#include "Gemm.hpp"
+#include "Workspace.hpp"
+
+// GEMM epilogues of the batch kernels, run on every finished output tile while it is still in L1
+// activate a tile of Z in place
+template <FUNCTION F, typename T>
+static void ActivateTile(T *out, T *, std::size_t n)
+{
+    ActivateBatch<F, T>({out, n});
+}
+
+// scale a tile of delta * W by f'(out), out being the matching tile of the forward outputs
+template <FUNCTION F, typename T>
+static void DerivativeTile(T *grad, T *out, std::size_t n)
+{
+    ActivateDerivativeBatch<F, T>({out, n}, {grad, n});
+}
+
+template <typename T>
+Layer<T>::Layer(unsigned int numNeurons, unsigned int numInputs, double bias, FUNCTION function, Arena *arena)
+    : m_size(numNeurons), m_numInputs(numInputs), m_stride(PaddedStride<T>(numInputs)), m_bias(bias), m_function(function), m_arena(arena)
+{
+    AllocateBuffer(m_outputs, m_size, m_arena);
+    AllocateBuffer(m_gradients, m_size, m_arena);
+    // the input layer has no incoming weights
+    if (m_numInputs == 0)
+        return;
+    AllocateBuffer(m_params, m_size * m_stride + PaddedStride<T>(m_size), m_arena);
+    m_weights = m_params.data();
+    m_biasWeights = m_params.data() + m_size * m_stride;
+}
+
+template <typename T>
+std::size_t Layer<T>::ArenaBytes(unsigned int numNeurons, unsigned int numInputs, bool withMasterWeights, unsigned int optimizerStates)
+{
+    std::size_t bytes = 2 * Arena::Footprint<T>(numNeurons);
+    if (numInputs == 0)
+        return bytes;
+    const std::size_t params = numNeurons * PaddedStride<T>(numInputs) + PaddedStride<T>(numNeurons);
+    bytes += Arena::Footprint<T>(params);
+    if (withMasterWeights)
+        bytes += Arena::Footprint<double>(params);
+    if (optimizerStates > 0)
+        bytes += withMasterWeights ? Arena::Footprint<double>(optimizerStates * params) : Arena::Footprint<T>(optimizerStates * params);
+    return bytes;
+}
+
+template <typename T>
+void Layer<T>::RandomizeWeights(std::mt19937 &rng)
+{
+    if (m_numInputs == 0)
+        return;
+    // drawn in double whatever T is, so a seed gives the same network in every precision
+    // the bias weight of a neuron is drawn right after its row, the order the rows held them in before
+    std::uniform_real_distribution<double> randomWeight(0.0, 1.0);
+    for (auto n = 0; n < m_size; ++n)
+    {
+        T *w = Weights(n);
+        for (auto c = 0; c < m_numInputs; ++c)
+        {
+            const double value = randomWeight(rng);
+            w[c] = static_cast<T>(value);
+            if (!m_master.empty())
+                m_master[n * m_stride + c] = value;
+        }
+        const double value = randomWeight(rng);
+        m_biasWeights[n] = static_cast<T>(value);
+        if (!m_master.empty())
+            m_master[m_size * m_stride + n] = value;
+    }
+}
+
+template <typename T>
+void Layer<T>::AttachWeights(T *weights, T *biasWeights)
+{
+    m_weights = weights;
+    m_biasWeights = biasWeights;
+}
+
+template <typename T>
+void Layer<T>::CopyWeights(const Layer &other)
+{
+    std::copy(other.m_weights, other.m_weights + m_size * m_stride, m_weights);
+    std::copy(other.m_biasWeights, other.m_biasWeights + m_size, m_biasWeights);
+    if (m_master.empty())
+        return;
+    // keep the master weights in step, widened from the T weights when other has none
+    double *masterBias = m_master.data() + m_size * m_stride;
+    if (!other.m_master.empty())
+    {
+        std::copy(other.m_master.data(), other.m_master.data() + m_size * m_stride, m_master.data());
+        std::copy(other.MasterBiasWeights(), other.MasterBiasWeights() + m_size, masterBias);
+    }
+    else
+    {
+        std::copy(other.m_weights, other.m_weights + m_size * m_stride, m_master.data());
+        std::copy(other.m_biasWeights, other.m_biasWeights + m_size, masterBias);
+    }
+}
+
+template <typename T>
+template <typename S>
+void Layer<T>::LoadWeights(const S *weights, std::size_t stride, const S *biasWeights)
+{
+    double *masterBias = m_master.empty() ? nullptr : m_master.data() + m_size * m_stride;
+    for (auto n = 0; n < m_size; ++n)
+    {
+        const S *src = weights + n * stride;
+        std::transform(src, src + m_numInputs, Weights(n), [](S w)
+                       { return static_cast<T>(w); });
+        const S bias = (biasWeights != nullptr) ? biasWeights[n] : src[m_numInputs];
+        m_biasWeights[n] = static_cast<T>(bias);
+        if (m_master.empty())
+            continue;
+        std::copy(src, src + m_numInputs, m_master.data() + n * m_stride);
+        masterBias[n] = bias;
+    }
+}
+
+template <typename T>
+void Layer<T>::EnableMasterWeights()
+{
+    if (m_numInputs == 0 || !m_master.empty())
+        return;
+    AllocateBuffer(m_master, m_params.size(), m_arena);
+    std::copy(m_weights, m_weights + m_size * m_stride, m_master.data());
+    std::copy(m_biasWeights, m_biasWeights + m_size, m_master.data() + m_size * m_stride);
+}
+
+template <typename T>
+void Layer<T>::EnableOptimizer(OPTIMIZER optimizer)
+{
+    m_optimizer = optimizer;
+    if (m_numInputs == 0)
+        return;
+    if (m_master.empty())
+        AllocateBuffer(m_state, OptimizerStates(optimizer) * m_params.size(), m_arena);
+    else
+        AllocateBuffer(m_masterState, OptimizerStates(optimizer) * m_params.size(), m_arena);
+}
+
+template <typename T>
+void Layer<T>::Update(const OptimizerStep &step, T *params, std::size_t offset, const T *x, double a, std::size_t n)
+{
+    if (step.optimizer != m_optimizer || (m_state.empty() && m_masterState.empty()))
+    {
+        std::cerr << "Optimizer state missing! Expected optimizer " << step.optimizer << ", Enabled " << m_optimizer << "." << std::endl;
+        exit(-1);
+    }
+    const std::size_t block = m_params.size(); // distance between the state blocks
+    if (m_master.empty())
+    {
+        T *state = m_state.data() + offset;
+        OptimizerUpdate(step, params, state, OptimizerStates(m_optimizer) > 1 ? state + block : nullptr, x, a, n);
+        return;
+    }
+    // mixed precision, small steps would round away in float so they accumulate in double
+    double *state = m_masterState.data() + offset;
+    if constexpr (std::is_same_v<T, float>)
+        OptimizerUpdate(step, m_master.data() + offset, state, OptimizerStates(m_optimizer) > 1 ? state + block : nullptr, x, a, n, params);
+}
+
+template <typename T>
+void Layer<T>::UpdateInputWeights(const Layer &prevLayer, const OptimizerStep &step)
+{
+    // Each row holds the incoming weights of one neuron, its gradient is the neuron's delta times the inputs,
+    // the bias input is m_bias so the bias weights take the deltas times m_bias, all in one pass
+    // the bias weights are left out of regularization, shrinking them would only shift the outputs
+    const T *in = prevLayer.Outputs();
+    for (auto n = 0; n < m_size; ++n)
+        Update(step, Weights(n), n * m_stride, in, m_gradients[n], m_numInputs);
+    Update(step.Unregularized(), m_biasWeights, m_size * m_stride, m_gradients.data(), m_bias, m_size);
+}
+
+template <typename T>
+template <FUNCTION F>
+void Layer<T>::CalcHiddenGradients(const Layer &nextLayer)
+{
+    // Sum our contributions of the errors at the nodes we feed,
+    // a one row delta * W, walking the next layer's weight matrix row by row keeps the access contiguous
+    GemmAB<T>(1, m_size, nextLayer.m_size, nextLayer.m_gradients.data(), nextLayer.m_size,
+              nextLayer.m_weights, nextLayer.m_stride, m_gradients.data(), m_size);
+    ActivateDerivativeBatch<F, T>({m_outputs.data(), m_size}, {m_gradients.data(), m_size});
+}
+
+template <typename T>
+template <FUNCTION F>
+double Layer<T>::OutputGradient(const T *out, T *grad, unsigned int label) const
+{
+    // one-hot target expanded on the fly, grad = y - out
+    for (auto n = 0; n < m_size; ++n)
+        grad[n] = -out[n];
+    grad[label] += 1;
+    if constexpr (F == SOFTMAX)
+    {
+        // softmax + cross-entropy, the gradient simplifies to y - p, nothing left to scale
+        return -std::log(std::max<double>(out[label], std::numeric_limits<T>::min()));
+    }
+    else
+    {
+        // RMS of output neuron errors, then scale by f'(out)
+        double error = 0.0;
+        for (auto n = 0; n < m_size; ++n)
+            error += static_cast<double>(grad[n]) * grad[n];
+        ActivateDerivativeBatch<F, T>({out, m_size}, {grad, m_size});
+        return std::sqrt(error / m_size);
+    }
+}
+
+template <typename T>
+template <FUNCTION F>
+double Layer<T>::CalcOutputGradients(unsigned int label)
+{
+    return OutputGradient<F>(m_outputs.data(), m_gradients.data(), label);
+}
+
+template <typename T>
+template <FUNCTION F>
+void Layer<T>::FeedForward(const Layer &prevLayer)
+{
+    // Sum the previous layer's outputs (which are our inputs), then add the bias
+    // a single sample, x * W^T as dot products read in place, nothing to pack
+    GemmEpilogue<T> epilogue{.bias = m_biasWeights, .biasScale = static_cast<T>(m_bias)};
+    GemmABt<T>(1, m_size, m_numInputs, prevLayer.Outputs(), m_numInputs,
+               m_weights, m_stride, m_outputs.data(), m_size, T(0), nullptr, epilogue);
+    ActivateBatch<F, T>({m_outputs.data(), m_size});
+}
+
+template <typename T>
+template <FUNCTION F>
+void Layer<T>::FeedForwardBatch(const LayerBatch<T> &prevBatch, LayerBatch<T> &batch, unsigned int rows) const
+{
+    // Z = X * W^T + bias * b, the bias is added and the activation applied tile by tile as Z comes out,
+    // softmax needs a whole row first
+    GemmEpilogue<T> epilogue{.bias = m_biasWeights, .biasScale = static_cast<T>(m_bias)};
+    if constexpr (F != SOFTMAX)
+        epilogue.apply = ActivateTile<F, T>;
+    GemmABt(rows, m_size, m_numInputs,
+            prevBatch.outputs.data(), prevBatch.outStride,
+            m_weights, m_stride,
+            batch.outputs.data(), batch.outStride, T(0), batch.pack, epilogue);
+    if constexpr (F == SOFTMAX)
+        for (auto r = 0; r < rows; ++r)
+            ActivateBatch<F, T>({batch.Outputs(r), m_size});
+}
+
+template <typename T>
+template <FUNCTION F>
+void Layer<T>::CalcOutputGradientsBatch(LayerBatch<T> &batch, const unsigned int *labels, double *losses, unsigned int rows) const
+{
+    for (auto r = 0; r < rows; ++r)
+        losses[r] = OutputGradient<F>(batch.Outputs(r), batch.Gradients(r), labels[r]);
+}
+
+template <typename T>
+template <FUNCTION F>
+void Layer<T>::CalcHiddenGradientsBatch(const Layer &nextLayer, const LayerBatch<T> &nextBatch, LayerBatch<T> &batch, unsigned int rows) const
+{
+    // delta = (delta_next * W_next) * f'(out)
+    // f'(out) only depends on the outputs FeedForwardBatch left behind, it is multiplied in tile by tile
+    GemmAB(rows, m_size, nextLayer.m_size,
+           nextBatch.gradients.data(), nextBatch.gradStride,
+           nextLayer.m_weights, nextLayer.m_stride,
+           batch.gradients.data(), batch.gradStride, T(0), batch.pack,
+           {DerivativeTile<F, T>, batch.outputs.data(), batch.outStride});
+}
+
+template <typename T>
+void Layer<T>::CalcWeightGradients(const LayerBatch<T> &prevBatch, LayerBatch<T> &batch, unsigned int rows) const
+{
+    // G = delta^T * X, summed over every sample of the batch
+    GemmAtB(m_size, m_numInputs, rows,
+            batch.gradients.data(), batch.gradStride,
+            prevBatch.outputs.data(), prevBatch.outStride,
+            batch.weightGradients.data(), m_stride, T(0), batch.pack);
+    // the bias input is the same for every sample, its gradient is the column sum of delta times the bias
+    T *biasGradients = batch.biasGradients.data();
+    std::fill(biasGradients, biasGradients + m_size, T(0));
+    for (auto r = 0; r < rows; ++r)
+    {
+        const T *g = batch.Gradients(r);
+        for (auto n = 0; n < m_size; ++n)
+            biasGradients[n] += g[n];
+    }
+    const T bias = static_cast<T>(m_bias);
+    for (auto n = 0; n < m_size; ++n)
+        biasGradients[n] *= bias;
+}
+
+template <typename T>
+void Layer<T>::ApplyWeightGradients(const T *weightGradients, const T *biasGradients, const OptimizerStep &step, double scale)
+{
+    // one update per batch, scale turns the summed gradient into the batch mean
+    // the whole weight block is a single pass, its padding columns have zero gradients and stay zero
+    Update(step, m_weights, 0U, weightGradients, scale, m_size * m_stride);
+    Update(step.Unregularized(), m_biasWeights, m_size * m_stride, biasGradients, scale, m_size);
+}
+
+// instantiate every kernel for every activation and scalar type
+#define INSTANTIATE_LAYER_KERNELS(T, F)                                                                         \
+    template void Layer<T>::FeedForward<F>(const Layer &);                                                       \
+    template double Layer<T>::CalcOutputGradients<F>(unsigned int);                                              \
+    template void Layer<T>::CalcHiddenGradients<F>(const Layer &);                                               \
+    template void Layer<T>::FeedForwardBatch<F>(const LayerBatch<T> &, LayerBatch<T> &, unsigned int) const;     \
+    template void Layer<T>::CalcOutputGradientsBatch<F>(LayerBatch<T> &, const unsigned int *, double *,         \
+                                                        unsigned int) const;                                     \
+    template void Layer<T>::CalcHiddenGradientsBatch<F>(const Layer &, const LayerBatch<T> &, LayerBatch<T> &, \
+                                                        unsigned int) const;
+
+#define INSTANTIATE_LAYER(T)                                                                  \
+    template class Layer<T>;                                                                  \
+    template void Layer<T>::LoadWeights<float>(const float *, std::size_t, const float *);    \
+    template void Layer<T>::LoadWeights<double>(const double *, std::size_t, const double *); \
+    INSTANTIATE_LAYER_KERNELS(T, SIGMOID)                                                     \
+    INSTANTIATE_LAYER_KERNELS(T, TANH)                                                        \
+    INSTANTIATE_LAYER_KERNELS(T, RELU)                                                        \
+    INSTANTIATE_LAYER_KERNELS(T, LINEAR)                                                      \
+    INSTANTIATE_LAYER_KERNELS(T, SOFTMAX)
+
+INSTANTIATE_LAYER(float)
+INSTANTIATE_LAYER(double)
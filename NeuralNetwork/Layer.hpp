@@ -0,0 +1,147 @@
+#pragma once
+#ifndef LAYER_H
+#define LAYER_H
+
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <vector>
+#include "Activation.hpp"
+#include "AlignedBuffer.hpp"
+#include "Arena.hpp"
+#include "Neuron.hpp"
+#include "Optimizer.hpp"
+
+template <typename T>
+struct LayerBatch;
+
+/* @brief
+ *   One layer of the network and the weights feeding into it
+ *   Weights are stored as one contiguous row-major block,
+ *   row n holds the input weights of neuron n, exactly NumInputs() wide (padded to a cache line)
+ *   The bias weights are a vector of their own, neuron n adds Bias() * BiasWeights()[n]
+ *   (the bias input, config "bias", is the same for every layer and sample)
+ *   The optimizer state (momentum, moments) sits in buffers laid out like the weights and bias weights,
+ *   so an update is one pass over contiguous memory, see Optimizer.hpp
+ *   The batch kernels only read the weights, their activations and gradients live in a
+ *   LayerBatch (see Workspace.hpp) so several threads can run them on one layer at once
+ *   The kernels are templated on the activation so each instantiation is branch free,
+ *   the activation stored in the layer is only read by the per-layer dispatch
+ *   T is the scalar type of weights, outputs and gradients (float or double), in mixed precision
+ *   a float layer also keeps double master weights that every update is applied to
+ *   Given an Arena every buffer is carved out of it (ArenaBytes() is the share to reserve),
+ *   otherwise each buffer is its own heap block
+ */
+template <typename T>
+class Layer
+{
+public:
+    Layer(unsigned int numNeurons, unsigned int numInputs, double bias, FUNCTION function = SIGMOID, Arena *arena = nullptr);
+    // arena bytes the constructor takes, plus EnableMasterWeights() with withMasterWeights
+    // and EnableOptimizer() with its OptimizerStates() as optimizerStates
+    static std::size_t ArenaBytes(unsigned int numNeurons, unsigned int numInputs, bool withMasterWeights = false, unsigned int optimizerStates = 0U);
+
+    inline unsigned int size() const { return m_size; }
+    inline unsigned int NumInputs() const { return m_numInputs; }
+    inline std::size_t Stride() const { return m_stride; } // in T
+    inline FUNCTION Function() const { return m_function; }
+    inline bool HasAttachedWeights() const { return m_weights != m_params.data(); }
+    inline bool HasMasterWeights() const { return !m_master.empty(); }
+    inline double Bias() const { return m_bias; }
+    inline Neuron<T> operator[](unsigned int n) { return Neuron<T>(&m_outputs[n], &m_gradients[n], Weights(n), m_biasWeights + n, m_numInputs); }
+
+    // row access into the contiguous weight block
+    inline T *Weights(unsigned int n) { return m_weights + n * m_stride; }
+    inline const T *Weights(unsigned int n) const { return m_weights + n * m_stride; }
+    // one bias weight per neuron
+    inline T *BiasWeights() { return m_biasWeights; }
+    inline const T *BiasWeights() const { return m_biasWeights; }
+    // double rows laid out like Weights() and BiasWeights(), only valid with HasMasterWeights()
+    inline const double *MasterWeights(unsigned int n) const { return m_master.data() + n * m_stride; }
+    inline const double *MasterBiasWeights() const { return m_master.data() + m_size * m_stride; }
+
+    inline T *Outputs() { return m_outputs.data(); }
+    inline const T *Outputs() const { return m_outputs.data(); }
+    inline const T *Gradients() const { return m_gradients.data(); }
+
+    void RandomizeWeights(std::mt19937 &rng);
+    // use external blocks (e.g. a memory mapped model) laid out like Weights() and BiasWeights() as the weights
+    // the blocks have to outlive the layer, the optimizer state stays owned by the layer
+    void AttachWeights(T *weights, T *biasWeights);
+    // copy the weights of a layer of the same shape into this layer's weights
+    void CopyWeights(const Layer &other);
+    // convert rows of another scalar type (stride apart) into the weights, master weights included
+    // without biasWeights the bias weight is read from column NumInputs() of every row (model files before version 3)
+    template <typename S>
+    void LoadWeights(const S *weights, std::size_t stride, const S *biasWeights = nullptr);
+    // mixed precision, keep double weights that the updates accumulate in
+    // the T weights become a rounded copy of them, refreshed by every update
+    void EnableMasterWeights();
+    // zeroed state for the update rule, in double with master weights so call EnableMasterWeights() first
+    // the layer can only be trained once this is done
+    void EnableOptimizer(OPTIMIZER optimizer);
+
+    // layer kernels, each runs over the whole weight matrix at once
+    template <FUNCTION F>
+    void FeedForward(const Layer &prevLayer);
+    template <FUNCTION F>
+    double CalcOutputGradients(unsigned int label); // target is the one-hot vector of label, returns the sample loss
+    template <FUNCTION F>
+    void CalcHiddenGradients(const Layer &nextLayer);
+    void UpdateInputWeights(const Layer &prevLayer, const OptimizerStep &step);
+
+    // batch kernels, the whole batch goes through one matrix-matrix product per layer
+    // batch is this layer's slice of the workspace, prevBatch/nextBatch the neighbouring slices
+    template <FUNCTION F>
+    void FeedForwardBatch(const LayerBatch<T> &prevBatch, LayerBatch<T> &batch, unsigned int rows) const;
+    template <FUNCTION F>
+    void CalcOutputGradientsBatch(LayerBatch<T> &batch, const unsigned int *labels, double *losses, unsigned int rows) const;
+    template <FUNCTION F>
+    void CalcHiddenGradientsBatch(const Layer &nextLayer, const LayerBatch<T> &nextBatch, LayerBatch<T> &batch, unsigned int rows) const;
+    void CalcWeightGradients(const LayerBatch<T> &prevBatch, LayerBatch<T> &batch, unsigned int rows) const;
+    // one update from gradients summed over a batch, laid out like the weights and bias weights
+    // both update kernels regularize the weights only, never the bias weights
+    void ApplyWeightGradients(const T *weightGradients, const T *biasGradients, const OptimizerStep &step, double scale);
+
+private:
+    // gradient and loss of one sample in a single pass over the output layer
+    template <FUNCTION F>
+    double OutputGradient(const T *out, T *grad, unsigned int label) const;
+    // apply the gradients a * x[i] to n weights starting at params, offset elements into the weight block
+    // (the bias weights start at m_size * m_stride), on the master weights when there are some
+    void Update(const OptimizerStep &step, T *params, std::size_t offset, const T *x, double a, std::size_t n);
+
+    unsigned int m_size = 0U;      // number of neurons, bias excluded
+    unsigned int m_numInputs = 0U; // number of neurons in the previous layer, bias excluded
+    std::size_t m_stride = 0U;     // padded row length of the weight matrix, bias weight excluded
+    AlignedBuffer<T> m_outputs;
+    AlignedBuffer<T> m_gradients;
+    double m_bias = 0.0;
+    FUNCTION m_function = SIGMOID;
+    AlignedBuffer<T> m_params;           // [weights | bias weights]
+    T *m_weights = nullptr;              // the weights in m_params, or an attached block
+    T *m_biasWeights = nullptr;          // the bias weights in m_params, or an attached block
+    AlignedBuffer<double> m_master;      // m_params in double, mixed precision only
+    AlignedBuffer<T> m_state;            // optimizer state, OptimizerStates() blocks laid out like m_params
+    AlignedBuffer<double> m_masterState; // the same in double, used instead with master weights
+    OPTIMIZER m_optimizer = SGD;
+    Arena *m_arena = nullptr;            // where the buffers come from, nullptr for the heap
+};
+
+// Activation policies for the training loop, fn is a template lambda []<FUNCTION F>() { ... }
+// every layer shares one activation fixed at compile time
+template <FUNCTION F>
+struct UniformActivation
+{
+    template <typename T, typename Fn>
+    static inline void Apply(const Layer<T> &, Fn &&fn) { fn.template operator()<F>(); }
+};
+
+// every layer may have its own activation, dispatched once per layer
+struct PerLayerActivation
+{
+    template <typename T, typename Fn>
+    static inline void Apply(const Layer<T> &layer, Fn &&fn) { DispatchActivation(layer.Function(), fn); }
+};
+
+#endif
@@ -0,0 +1,226 @@
+#pragma once
+#ifndef MODELFORMAT_H
+#define MODELFORMAT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/* @brief
+ *   Binary model file layout (little endian, every block 64 byte aligned)
+ *
+ *   [ModelHeader][ModelLayerRecord x numLayers][pad][weights layer 1][pad][bias weights layer 1][pad][weights layer 2] ... [pad][normalization]
+ *
+ *   Each weight block is the layer's row-major weight matrix exactly as it is held in memory,
+ *   rows = neurons, stride = padded row length, followed by the layer's bias weights, one per neuron (version 3).
+ *   Weights are float or double (scalarBytes), mixed precision networks save their double master weights.
+ *   Blocks are aligned so a memory mapped file can be used in place.
+ *   The optional normalization block holds normInputs offsets followed by normInputs scales,
+ *   the input transform x' = (x - offset) * scale the model was trained with (version 2).
+ *   The checksum covers everything after the header, XXH64 since version 4 (64-bit FNV-1a before).
+ *   Version 1 files had zeros where the normalization fields are, so they read as "no normalization".
+ *   Before version 3 there were no bias blocks, the last used column of every row was the bias weight.
+ */
+constexpr char MODEL_MAGIC[8] = {'S', 'N', 'N', 'M', 'O', 'D', 'E', 'L'};
+constexpr std::uint32_t MODEL_VERSION = 4U;
+constexpr std::uint32_t MODEL_MIN_VERSION = 1U;  // oldest version that still loads
+constexpr std::uint32_t MODEL_BIAS_VERSION = 3U; // first version with bias blocks
+constexpr std::uint32_t MODEL_XXH64_VERSION = 4U; // first version with the word at a time checksum
+constexpr std::size_t MODEL_ALIGNMENT = 64U;
+
+struct ModelHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t numLayers;
+    std::uint32_t scalarBytes; // sizeof the weight type, 8 for double, 4 for float
+    std::uint32_t normInputs;  // columns of the normalization block, 0 when inputs are used as is
+    double bias;               // value of the bias input of every layer
+    std::uint64_t fileBytes;   // total size, catches truncated files
+    std::uint64_t checksum;    // ModelChecksum() over [sizeof(ModelHeader), fileBytes)
+    std::uint64_t normOffset;  // byte offset of the normalization block, 0 when there is none
+    std::uint8_t padding[8];
+};
+static_assert(sizeof(ModelHeader) == MODEL_ALIGNMENT, "model header must fill one aligned block");
+
+struct ModelLayerRecord
+{
+    std::uint32_t size;       // neurons, bias excluded
+    std::uint32_t numInputs;  // neurons of the previous layer, bias excluded
+    std::uint32_t activation; // FUNCTION
+    std::uint32_t reserved;
+    std::uint64_t stride;     // padded row length in scalars
+    std::uint64_t offset;     // byte offset of the weight block, 0 for the input layer
+};
+
+/* @brief
+ *   Quantized model file layout, same alignment and checksum rules as the model file
+ *
+ *   [QuantHeader][QuantLayerRecord x numLayers][pad][layer 1 blocks][pad][layer 2 blocks] ... [pad][normalization]
+ *
+ *   Every layer after the input layer has four blocks, each 64 byte aligned:
+ *   int8 weights (rows = neurons, stride = padded input count, bias column left out, padding zero),
+ *   float per row weight scales, int32 per row weight sums and float bias weights.
+ *   A layer input x is stored as q = round(x / inScale) + inZero in [0, QUANT_ACTIVATION_MAX],
+ *   so z = inScale * weightScale * (sum(q * w) - inZero * weightSum) + biasWeight * bias.
+ */
+constexpr char QUANT_MAGIC[8] = {'S', 'N', 'N', 'Q', 'U', 'A', 'N', 'T'};
+constexpr std::uint32_t QUANT_VERSION = 2U;
+constexpr std::uint32_t QUANT_MIN_VERSION = 1U;   // version 1 has the FNV-1a checksum
+constexpr std::uint32_t QUANT_XXH64_VERSION = 2U;
+
+struct QuantHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t numLayers;
+    std::uint32_t normInputs; // columns of the normalization block, 0 when inputs are used as is
+    std::uint32_t reserved;
+    double bias;              // value of the bias input of every layer
+    std::uint64_t fileBytes;  // total size, catches truncated files
+    std::uint64_t checksum;   // ModelChecksum() over [sizeof(QuantHeader), fileBytes)
+    std::uint64_t normOffset; // byte offset of the normalization block, 0 when there is none
+    std::uint8_t padding[8];
+};
+static_assert(sizeof(QuantHeader) == MODEL_ALIGNMENT, "quantized header must fill one aligned block");
+
+struct QuantLayerRecord
+{
+    std::uint32_t size;       // neurons, bias excluded
+    std::uint32_t numInputs;  // neurons of the previous layer, bias excluded
+    std::uint32_t activation; // FUNCTION
+    std::int32_t inZero;      // zero point of the layer input
+    float inScale;            // scale of the layer input
+    std::uint32_t reserved;
+    std::uint64_t stride;        // padded row length of the int8 weights in bytes
+    std::uint64_t weightOffset;  // byte offsets of the four blocks, 0 for the input layer
+    std::uint64_t scaleOffset;
+    std::uint64_t sumOffset;
+    std::uint64_t biasOffset;
+};
+static_assert(sizeof(QuantLayerRecord) == MODEL_ALIGNMENT, "quantized layer record must fill one aligned block");
+
+inline std::size_t AlignModelOffset(std::size_t offset)
+{
+    return (offset + MODEL_ALIGNMENT - 1) / MODEL_ALIGNMENT * MODEL_ALIGNMENT;
+}
+
+// byte offset of the bias block of a layer, right after its weight block (version 3)
+inline std::size_t ModelBiasOffset(const ModelLayerRecord &record, std::size_t scalarBytes)
+{
+    return AlignModelOffset(record.offset + record.size * record.stride * scalarBytes);
+}
+
+// 64 bit FNV-1a, the checksum of model files before version 4 and quantized files of version 1
+// one multiply per byte, seed lets the hash be continued over several blocks
+inline std::uint64_t ModelChecksumFnv(const void *data, std::size_t bytes, std::uint64_t seed = 14695981039346656037ULL)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < bytes; ++i)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* @brief
+ *   XXH64 (seed 0) of a payload handed over in pieces of any size, the checksum of the current formats
+ *   Four independent lanes take a 32 byte stripe per round, 8 bytes each, so verifying a model
+ *   on load runs at memory speed instead of one dependent multiply per byte
+ */
+class ModelHasher
+{
+public:
+    void Update(const void *data, std::size_t bytes)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        m_bytes += bytes;
+        if (m_buffered != 0)
+        {
+            // complete the stripe left over from the last piece first
+            const std::size_t take = std::min(bytes, STRIPE - m_buffered);
+            std::memcpy(m_buffer + m_buffered, p, take);
+            m_buffered += take;
+            p += take;
+            bytes -= take;
+            if (m_buffered < STRIPE)
+                return;
+            Stripe(m_buffer);
+            m_buffered = 0;
+        }
+        for (; bytes >= STRIPE; p += STRIPE, bytes -= STRIPE)
+            Stripe(p);
+        std::memcpy(m_buffer, p, bytes);
+        m_buffered = bytes;
+    }
+
+    std::uint64_t Digest() const
+    {
+        std::uint64_t hash;
+        if (m_bytes >= STRIPE)
+        {
+            hash = Rotl(m_lanes[0], 1) + Rotl(m_lanes[1], 7) + Rotl(m_lanes[2], 12) + Rotl(m_lanes[3], 18);
+            for (const std::uint64_t lane : m_lanes)
+                hash = (hash ^ Round(0, lane)) * PRIME1 + PRIME4;
+        }
+        else
+            hash = PRIME5;
+        hash += m_bytes;
+        // the tail that did not fill a stripe, words, then a half word, then bytes
+        std::size_t i = 0;
+        for (; i + 8 <= m_buffered; i += 8)
+            hash = Rotl(hash ^ Round(0, Load<std::uint64_t>(m_buffer + i)), 27) * PRIME1 + PRIME4;
+        if (i + 4 <= m_buffered)
+        {
+            hash = Rotl(hash ^ Load<std::uint32_t>(m_buffer + i) * PRIME1, 23) * PRIME2 + PRIME3;
+            i += 4;
+        }
+        for (; i < m_buffered; ++i)
+            hash = Rotl(hash ^ m_buffer[i] * PRIME5, 11) * PRIME1;
+        // final avalanche
+        hash = (hash ^ (hash >> 33)) * PRIME2;
+        hash = (hash ^ (hash >> 29)) * PRIME3;
+        return hash ^ (hash >> 32);
+    }
+
+private:
+    static constexpr std::size_t STRIPE = 32;
+    static constexpr std::uint64_t PRIME1 = 11400714785074694791ULL;
+    static constexpr std::uint64_t PRIME2 = 14029467366897019727ULL;
+    static constexpr std::uint64_t PRIME3 = 1609587929392839161ULL;
+    static constexpr std::uint64_t PRIME4 = 9650029242287828579ULL;
+    static constexpr std::uint64_t PRIME5 = 2870177450012600261ULL;
+
+    static inline std::uint64_t Rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static inline std::uint64_t Round(std::uint64_t lane, std::uint64_t word) { return Rotl(lane + word * PRIME2, 31) * PRIME1; }
+    // the files are little endian, like every target the format is used on
+    template <typename U>
+    static inline U Load(const unsigned char *p)
+    {
+        U value;
+        std::memcpy(&value, p, sizeof(U));
+        return value;
+    }
+    inline void Stripe(const unsigned char *p)
+    {
+        for (auto lane = 0; lane < 4; ++lane)
+            m_lanes[lane] = Round(m_lanes[lane], Load<std::uint64_t>(p + 8 * lane));
+    }
+
+    std::uint64_t m_lanes[4] = {PRIME1 + PRIME2, PRIME2, 0ULL, 0ULL - PRIME1};
+    unsigned char m_buffer[STRIPE] = {};
+    std::size_t m_buffered = 0U; // bytes of an incomplete stripe in m_buffer
+    std::uint64_t m_bytes = 0U;
+};
+
+inline std::uint64_t ModelChecksum(const void *data, std::size_t bytes)
+{
+    ModelHasher hasher;
+    hasher.Update(data, bytes);
+    return hasher.Digest();
+}
+
+#endif
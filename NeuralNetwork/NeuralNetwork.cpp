@@ -1,6 +1,33 @@
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include "NeuralNetwork.hpp"
+#include "AllocationCounter.hpp"
+#include "ModelFormat.hpp"
+#include "Profiler.hpp"
+#include "QuantizedNetwork.hpp"
+
+#ifdef SNN_PROFILE
+// nominal work of one sample, multiply-adds count as 2 FLOPs, bytes are the weights streamed
+template <typename T>
+static std::uint64_t ForwardFlops(const std::vector<Layer<T>> &network)
+{
+    std::uint64_t flops = 0U;
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
+        flops += 2ULL * network[index_layer].size() * (network[index_layer].NumInputs() + 1);
+    return flops;
+}
+template <typename T>
+static std::uint64_t WeightBytes(const std::vector<Layer<T>> &network)
+{
+    std::uint64_t bytes = 0U;
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
+        bytes += network[index_layer].size() * (network[index_layer].Stride() + 1) * sizeof(T); // bias weights included
+    return bytes;
+}
+#endif
 
 void NeuralNetwork::ParseConfig()
 {
@@ -29,67 +56,523 @@ void NeuralNetwork::ParseConfig()
         .exportWeightPath = config["exportWeightPath"],
         .topology = config["topology"],
         .training_split = config["training_split"],
+        .test_split = config.value("test_split", config["training_split"].get<double>()),
         .learning_rate = config["learning_rate"],
         .momentum = config["momentum"],
+        .optimizer = config.value("optimizer", (unsigned short)SGD),
+        .beta1 = config.value("beta1", 0.9),
+        .beta2 = config.value("beta2", 0.999),
+        .epsilon = config.value("epsilon", 1e-8),
+        .weightDecay = config.value("weightDecay", config.value("optimizer", (unsigned short)SGD) == ADAMW ? 0.01 : 0.0),
         .bias = config["bias"],
         .activationFunction = config["hiddenLayerActivation"],
         .epoch = config["epoch"],
-        .accuracyThreshold = config["accuracyThreshold"]
+        .accuracyThreshold = config["accuracyThreshold"],
+        // optional hyperparameters, fall back to the defaults when missing
+        .isBatchLearning = config.value("isBatchLearning", false),
+        .batchsize = config.value("batchSize", (unsigned short)10U),
+        .layerActivations = config.value("layerActivations", std::vector<unsigned short>{}),
+        .outputActivation = config.value("outputLayerActivation", config["hiddenLayerActivation"].get<unsigned short>()),
+        .threads = config.value("threads", (unsigned short)1U),
+        .verbosity = config.value("verbosity", (unsigned short)PER_EPOCH),
+        .reportInterval = config.value("reportInterval", 100U),
+        .seed = config.value("seed", 0U),
+        .normalization = config.value("normalization", (unsigned short)NO_NORMALIZATION),
+        .validationInterval = config.value("validationInterval", (unsigned short)1U),
+        .precision = config.value("precision", (unsigned short)DOUBLE_PRECISION),
+        .quantizedExportPath = config.value("quantizedExportPath", std::string{}),
+        .calibrationSamples = config.value("calibrationSamples", 256U),
+        .tracePath = config.value("tracePath", std::string{}),
+        .regularization = config.value("regularization", (unsigned short)NO_REGULARIZATION),
+        .regularizationRate = config.value("regularizationRate", 0.0)
         // @todo add additional hyperparameters
-        //  .isBatchLearning = config["isBatchLearning"],
-        //  .batchsize = config["batchSize"],
-        //  .isRegularized = config["isRegularized"],
-        //  .regularizationRate = config["regularizationRate"]
     };
-    // read in the dataset file
-    ptr_ds->ReadDataset(m_config.datasetPath, m_config.tokenPath);
-    // extract the input and output datasets
-    ptr_ds->ExtractInOut(m_config.topology[0]);
+    if (m_config.precision > MIXED_PRECISION)
+    {
+        std::cerr << "Precision not recognized! Found " << m_config.precision << "." << std::endl;
+        exit(-1);
+    }
+    if (m_config.optimizer > ADAMW)
+    {
+        std::cerr << "Optimizer not recognized! Found " << m_config.optimizer << "." << std::endl;
+        exit(-1);
+    }
+    if (m_config.regularization > L2_REGULARIZATION)
+    {
+        std::cerr << "Regularization not recognized! Found " << m_config.regularization << "." << std::endl;
+        exit(-1);
+    }
+    m_rng.seed(m_config.seed != 0 ? m_config.seed : std::random_device{}());
+    // the dataset is parsed straight into the scalar type the network runs in
+    DispatchPrecision(Precision(), [&]<typename T>()
+                      {
+                          std::unique_ptr<Dataset<T>> &dataset = State<T>().dataset;
+                          dataset = std::make_unique<Dataset<T>>();
+                          // read in the dataset file
+                          dataset->ReadDataset(m_config.datasetPath, m_config.tokenPath);
+                          dataset->ShuffleData(m_rng);
+                          dataset->SplitDataset(m_config.training_split, m_config.test_split);
+                          // extract the input and output datasets, inputs are scaled in place
+                          dataset->ExtractInOut(m_config.topology[0], static_cast<NORMALIZATION>(m_config.normalization));
+                          m_normalizer = dataset->GetNormalizer(); });
+}
+
+OptimizerStep NeuralNetwork::NextOptimizerStep()
+{
+    return OptimizerStep{.optimizer = static_cast<OPTIMIZER>(m_config.optimizer),
+                         .learningRate = m_config.learning_rate,
+                         .momentum = m_config.momentum,
+                         .beta1 = m_config.beta1,
+                         .beta2 = m_config.beta2,
+                         .epsilon = m_config.epsilon,
+                         .regularization = static_cast<REGULARIZATION>(m_config.regularization),
+                         .regularizationRate = m_config.regularizationRate,
+                         .weightDecay = m_config.weightDecay,
+                         .step = ++m_updateSteps};
 }
 
 void NeuralNetwork::Train()
+{
+    DispatchPrecision(Precision(), [&]<typename T>()
+                      { TrainNetwork<T>(); });
+}
+
+template <typename T>
+void NeuralNetwork::TrainNetwork()
 {
     std::cout << "-----------------------------------------------------" << std::endl;
     std::cout << "Training started! " << std::endl;
     std::cout << "-----------------------------------------------------" << std::endl;
-    InitNetwork();
+    std::vector<Layer<T>> &network = State<T>().network;
+    std::vector<BatchWorkspace<T>> &workspaces = State<T>().workspaces;
+    Dataset<T> &dataset = *State<T>().dataset;
+    // the batch layout sizes the arena, every buffer a training step touches is carved out of it up front
+    const std::size_t trainingRows = dataset.GetData().d_training.size();
+    const unsigned int batchsize = (m_config.isBatchLearning && m_config.batchsize > 1) ? std::min<std::size_t>(m_config.batchsize, trainingRows) : 1U;
+    const unsigned int numThreads = std::clamp<unsigned int>(m_config.threads, 1U, batchsize);
+    const unsigned int shard = (batchsize + numThreads - 1) / numThreads;
+    std::size_t workspaceBytes = BatchWorkspace<T>::ArenaBytes(m_config.topology, PREDICT_BATCH, false); // validation
+    if (batchsize > 1)
+        workspaceBytes += numThreads * BatchWorkspace<T>::ArenaBytes(m_config.topology, shard);
+    InitNetwork<T>(workspaceBytes);
+    Arena &arena = State<T>().arena;
+    // continue from a trained model instead of random weights
+    if (!m_config.importWeightPath.empty())
+        ImportNetwork<T>();
+    // the weights get trained on (and exported with) the scaling of this dataset,
+    // unless the imported model brought its own, then the dataset is scaled like the model was trained
+    if (!m_config.importWeightPath.empty() && !m_normalizer.empty())
+        dataset.Rescale(m_normalizer);
+    else
+        m_normalizer = dataset.GetNormalizer();
     unsigned int training_pass = 1U;
-    // @todo normalized input value
-    Matrix2D<double> in = ptr_ds->GetData().in_vector;
+    // views into the dataset, nothing is copied, inputs already normalized
+    const MatrixView<T> in = dataset.GetData().in_vector;
     // @remark
-    // use the splitted output vector
-    // should also use softmax function for output layer activation
-    Matrix2D<double> out = ptr_ds->GetData().out_vector_s;
-    if (in.size() != out.size())
+    // use the class index of every row, the loss expands it to the one-hot target
+    const std::vector<unsigned int> &labels = dataset.GetData().out_class;
+    if (in.size() != labels.size())
     {
         std::cerr << "Input size not match output size! " << std::endl;
         exit(-1);
     }
-    unsigned int size = in.size();
+    if (dataset.GetData().numClasses > network.back().size())
+    {
+        std::cerr << "Output size mismatched! Expected at most " << network.back().size() << " Classes, Found " << dataset.GetData().numClasses << "." << std::endl;
+        exit(-1);
+    }
+    // the split is a set of ranges over the shuffled order
+    // epochs walk the training rows through this permutation, reshuffled every epoch
+    const DatasetStructure<T> &data = dataset.GetData();
+    std::vector<unsigned int> order(data.d_order.begin() + data.d_training.begin, data.d_order.begin() + data.d_training.end);
+    std::span<const unsigned int> validation(data.d_order.data() + data.d_validation.begin, data.d_validation.size());
+    std::span<const unsigned int> test(data.d_order.data() + data.d_test.begin, data.d_test.size());
+    unsigned int size = order.size();
+    if (size == 0)
+    {
+        std::cerr << "No rows left for training! " << std::endl;
+        exit(-1);
+    }
+    if (batchsize > 1)
+    {
+        // data-parallel mini-batch training, every worker gets a shard of each batch
+        m_pool = std::make_unique<ThreadPool>(numThreads);
+        for (auto t = 0; t < numThreads; ++t)
+            workspaces.emplace_back(network, shard, true, &arena);
+    }
+    else if (m_config.threads > 1)
+        std::cout << "Multi-threading needs batch learning, training on a single thread." << std::endl;
     m_recentAverageError = 0;
-    // either epoch ended or accuracy threshold reached after certain % of epoch
+    m_stepAllocations = 0U;
+    m_updateSteps = 0UL; // the optimizer state starts out zeroed with the network
+    // validation scores a copy of the weights on its own thread, training never waits for it
+    BatchWorkspace<T> validationWs(network, PREDICT_BATCH, false, &arena);
+    std::unique_ptr<Validator<T>> validator = nullptr;
+    if (!validation.empty())
+        validator = std::make_unique<Validator<T>>(network, [&](const std::vector<Layer<T>> &snapshot)
+                                                   { return Accuracy(snapshot, validationWs, in, labels, validation); });
+    // progress is printed from a background thread, the loop below never touches the console
+    m_reporter = std::make_unique<ProgressReporter>(static_cast<VERBOSITY>(m_config.verbosity), m_config.reportInterval);
+    PROFILE_THREAD(); // the training thread's trace buffer, allocated before the first step
+    // pick the activation once, every layer kernel below is a branch free instantiation
+    if (IsUniformActivation(network))
+        training_pass = DispatchActivation(static_cast<FUNCTION>(m_config.activationFunction), [&]<FUNCTION F>()
+                                           { return TrainLoop<T, UniformActivation<F>>(in, labels, order, batchsize, validator.get(), validation.size()); });
+    else
+        training_pass = TrainLoop<T, PerLayerActivation>(in, labels, order, batchsize, validator.get(), validation.size());
+    validator.reset();
+    m_reporter->Stop();
+    PROFILE_REPORT(m_config.tracePath);
+    std::cout << "-----------------------------------------------------" << std::endl;
+    std::cout << "Training ended at Epoch " << training_pass << " with Error of " << m_recentAverageError << "." << std::endl;
+    if (!validation.empty())
+        std::cout << "Validation accuracy : " << Accuracy(network, validationWs, in, labels, validation) << " (" << validation.size() << " Samples)" << std::endl;
+    if (!test.empty())
+        std::cout << "Test accuracy : " << Accuracy(network, validationWs, in, labels, test) << " (" << test.size() << " Samples)" << std::endl;
+#ifdef SNN_COUNT_ALLOCATIONS
+    std::cout << "Training step heap allocations : " << m_stepAllocations << " (Arena " << State<T>().arena.Used() << " / " << State<T>().arena.Capacity() << " Bytes)" << std::endl;
+    if (m_stepAllocations != 0U)
+        std::cerr << "Training steps allocated on the heap! " << std::endl;
+#endif
+    std::cout << "-----------------------------------------------------" << std::endl;
+    if (!m_config.exportWeightPath.empty())
+        ExportNetwork<T>();
+    if (!m_config.quantizedExportPath.empty())
+        ExportQuantizedNetwork<T>();
+}
+
+void NeuralNetwork::ExportWeights()
+{
+    DispatchPrecision(Precision(), [&]<typename T>()
+                      { ExportNetwork<T>(); });
+}
+
+template <typename T>
+void NeuralNetwork::ExportNetwork()
+{
+    const std::vector<Layer<T>> &network = State<T>().network;
+    if (network.empty())
+    {
+        std::cerr << "Nothing to export, network not initialized! " << std::endl;
+        return;
+    }
+    // written next to the target and renamed over it once complete, the layers may still read their weights
+    // from the mapping of an imported model at the same path, truncating that file would pull the pages away
+    const std::string tempPath = m_config.exportWeightPath + ".tmp";
+    std::ofstream f(tempPath, std::ios::binary | std::ios::trunc);
+    if (!f.is_open())
+    {
+        std::cerr << "Failed to open file! Export Path : " << tempPath << std::endl;
+        return;
+    }
+
+    // mixed precision saves its double master weights, otherwise the weights are saved as they are held
+    const bool isMaster = network.size() > 1 && network[1].HasMasterWeights();
+    const std::size_t scalarBytes = isMaster ? sizeof(double) : sizeof(T);
+    // lay out the blocks first, every weight block starts on an aligned offset
+    std::vector<ModelLayerRecord> records(network.size());
+    std::size_t offset = AlignModelOffset(sizeof(ModelHeader) + records.size() * sizeof(ModelLayerRecord));
+    for (auto index_layer = 0; index_layer < network.size(); ++index_layer)
+    {
+        const Layer<T> &layer = network[index_layer];
+        records[index_layer] = ModelLayerRecord{layer.size(), layer.NumInputs(), static_cast<std::uint32_t>(layer.Function()), 0U, layer.Stride(), 0U};
+        if (index_layer == 0)
+            continue; // the input layer has no weights
+        records[index_layer].offset = offset;
+        offset = AlignModelOffset(offset + layer.size() * layer.Stride() * scalarBytes);
+        offset = AlignModelOffset(offset + layer.size() * scalarBytes); // bias weights, ModelBiasOffset()
+    }
+    const std::size_t normOffset = m_normalizer.empty() ? 0U : offset;
+    if (!m_normalizer.empty())
+        offset = AlignModelOffset(offset + 2 * m_normalizer.size() * sizeof(double));
+
+    ModelHeader header{};
+    std::copy(std::begin(MODEL_MAGIC), std::end(MODEL_MAGIC), header.magic);
+    header.version = MODEL_VERSION;
+    header.numLayers = network.size();
+    header.scalarBytes = scalarBytes;
+    header.bias = m_config.bias;
+    header.fileBytes = offset;
+    header.normInputs = m_normalizer.size();
+    header.normOffset = normOffset;
+
+    // stream the payload, hashing exactly the bytes that are written
+    const char zeros[MODEL_ALIGNMENT] = {};
+    ModelHasher checksum;
+    std::size_t written = sizeof(ModelHeader);
+    auto write = [&](const void *data, std::size_t bytes)
+    {
+        f.write(static_cast<const char *>(data), bytes);
+        checksum.Update(data, bytes);
+        written += bytes;
+    };
+    auto pad = [&]()
+    { write(zeros, AlignModelOffset(written) - written); };
+
+    f.write(reinterpret_cast<const char *>(&header), sizeof(header)); // placeholder, rewritten with the checksum
+    write(records.data(), records.size() * sizeof(ModelLayerRecord));
+    pad();
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
+    {
+        const Layer<T> &layer = network[index_layer];
+        if (isMaster)
+            write(layer.MasterWeights(0), layer.size() * layer.Stride() * scalarBytes);
+        else
+            write(layer.Weights(0), layer.size() * layer.Stride() * scalarBytes);
+        pad();
+        if (isMaster)
+            write(layer.MasterBiasWeights(), layer.size() * scalarBytes);
+        else
+            write(layer.BiasWeights(), layer.size() * scalarBytes);
+        pad();
+    }
+    if (!m_normalizer.empty())
+    {
+        write(m_normalizer.Offsets().data(), m_normalizer.size() * sizeof(double));
+        write(m_normalizer.Scales().data(), m_normalizer.size() * sizeof(double));
+        pad();
+    }
+    header.checksum = checksum.Digest();
+    f.seekp(0);
+    f.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    f.close(); // remember to close file to prevent leak
+    // the old file stays valid for anything still mapping it until it is unmapped
+    if (!f.good() || std::rename(tempPath.c_str(), m_config.exportWeightPath.c_str()) != 0)
+    {
+        std::cerr << "Failed to write file! Export Path : " << m_config.exportWeightPath << std::endl;
+        std::remove(tempPath.c_str());
+        return;
+    }
+    std::cout << "Weights exported to : " << m_config.exportWeightPath << std::endl;
+}
+
+void NeuralNetwork::ExportQuantized()
+{
+    DispatchPrecision(Precision(), [&]<typename T>()
+                      { ExportQuantizedNetwork<T>(); });
+}
+
+template <typename T>
+void NeuralNetwork::ExportQuantizedNetwork()
+{
+    const std::vector<Layer<T>> &network = State<T>().network;
+    if (network.size() < 2)
+    {
+        std::cerr << "Nothing to quantize, network not initialized! " << std::endl;
+        return;
+    }
+    // calibrate on the first rows of the shuffled training split, already normalized like Predict normalizes
+    const DatasetStructure<T> &data = State<T>().dataset->GetData();
+    std::span<const unsigned int> sample(data.d_order.data() + data.d_training.begin,
+                                         std::min<std::size_t>(m_config.calibrationSamples, data.d_training.size()));
+    if (sample.empty())
+    {
+        std::cerr << "No training rows to calibrate the quantization on! " << std::endl;
+        return;
+    }
+    // ranges[l] collects the outputs of layer l, the inputs of layer l + 1
+    std::vector<std::pair<double, double>> ranges(network.size() - 1, {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()});
+    BatchWorkspace<T> ws(network, PREDICT_BATCH, false);
+    const bool isUniform = IsUniformActivation(network);
+    for (std::size_t first = 0; first < sample.size(); first += ws.Capacity())
+    {
+        const unsigned int rows = std::min<std::size_t>(ws.Capacity(), sample.size() - first);
+        for (auto r = 0; r < rows; ++r)
+        {
+            std::span<const T> row = data.in_vector[sample[first + r]];
+            std::copy(row.begin(), row.end(), ws[0].Outputs(r));
+        }
+        if (isUniform)
+            DispatchActivation(static_cast<FUNCTION>(m_config.activationFunction), [&]<FUNCTION F>()
+                               { FeedForwardBatch<T, UniformActivation<F>>(network, ws, rows); });
+        else
+            FeedForwardBatch<T, PerLayerActivation>(network, ws, rows);
+        for (auto index_layer = 0; index_layer < ranges.size(); ++index_layer)
+            for (auto r = 0; r < rows; ++r)
+            {
+                const auto [lo, hi] = std::minmax_element(ws[index_layer].Outputs(r), ws[index_layer].Outputs(r) + network[index_layer].size());
+                ranges[index_layer].first = std::min<double>(ranges[index_layer].first, *lo);
+                ranges[index_layer].second = std::max<double>(ranges[index_layer].second, *hi);
+            }
+    }
+
+    QuantizedNetwork quantized;
+    quantized.Build(network, ranges, m_normalizer);
+    if (!quantized.Save(m_config.quantizedExportPath))
+    {
+        std::cerr << "Failed to open file! Quantized Export Path : " << m_config.quantizedExportPath << std::endl;
+        return;
+    }
+    std::cout << "Quantized model exported to : " << m_config.quantizedExportPath << " (" << quantized.Bytes() << " Bytes, "
+              << sample.size() << " Calibration Samples)" << std::endl;
+}
+
+void NeuralNetwork::ImportWeights()
+{
+    DispatchPrecision(Precision(), [&]<typename T>()
+                      { ImportNetwork<T>(); });
+}
+
+template <typename T>
+void NeuralNetwork::ImportNetwork()
+{
+    std::vector<Layer<T>> &network = State<T>().network;
+    const std::string &path = m_config.importWeightPath;
+    if (!m_model.Open(path))
+    {
+        std::cerr << "Failed to open file! Import Path : " << path << std::endl;
+        exit(-1);
+    }
+    const ModelHeader *header = reinterpret_cast<const ModelHeader *>(m_model.data());
+    if (m_model.size() < sizeof(ModelHeader) || !std::equal(std::begin(MODEL_MAGIC), std::end(MODEL_MAGIC), header->magic) ||
+        header->version < MODEL_MIN_VERSION || header->version > MODEL_VERSION || header->fileBytes != m_model.size() ||
+        sizeof(ModelHeader) + header->numLayers * sizeof(ModelLayerRecord) > m_model.size() ||
+        (header->scalarBytes != sizeof(double) && header->scalarBytes != sizeof(float)))
+    {
+        std::cerr << "Not a valid model file! Import Path : " << path << std::endl;
+        exit(-1);
+    }
+    const char *payload = m_model.data() + sizeof(ModelHeader);
+    const std::size_t payloadBytes = m_model.size() - sizeof(ModelHeader);
+    const std::uint64_t checksum = (header->version >= MODEL_XXH64_VERSION) ? ModelChecksum(payload, payloadBytes) : ModelChecksumFnv(payload, payloadBytes);
+    if (checksum != header->checksum)
+    {
+        std::cerr << "Model checksum mismatched! Import Path : " << path << std::endl;
+        exit(-1);
+    }
+    // the network is built from the config, the model has to describe the same network
+    const ModelLayerRecord *records = reinterpret_cast<const ModelLayerRecord *>(m_model.data() + sizeof(ModelHeader));
+    bool matched = header->numLayers == network.size() && header->bias == m_config.bias &&
+                   (header->normInputs == 0 || (header->normInputs == network.front().size() && header->normOffset % MODEL_ALIGNMENT == 0 &&
+                                                header->normOffset + 2 * header->normInputs * sizeof(double) <= m_model.size()));
+    // the row stride is padded for the scalar type of the file, so it only has to hold a row
+    // before version 3 the bias weight was the last column of every row, since then it is a block of its own
+    const bool hasBiasBlock = header->version >= MODEL_BIAS_VERSION;
+    for (auto index_layer = 0; matched && index_layer < network.size(); ++index_layer)
+    {
+        const Layer<T> &layer = network[index_layer];
+        const ModelLayerRecord &record = records[index_layer];
+        const std::size_t end = hasBiasBlock ? ModelBiasOffset(record, header->scalarBytes) + layer.size() * header->scalarBytes
+                                             : record.offset + layer.size() * record.stride * header->scalarBytes;
+        matched = record.size == layer.size() && record.numInputs == layer.NumInputs() &&
+                  (index_layer == 0 || (record.stride >= layer.NumInputs() + (hasBiasBlock ? 0 : 1) && record.activation == layer.Function() &&
+                                        record.offset % MODEL_ALIGNMENT == 0 && end <= m_model.size()));
+    }
+    if (!matched)
+    {
+        std::cerr << "Model does not match the configured topology/activation/bias/inputs! Import Path : " << path << std::endl;
+        exit(-1);
+    }
+    // use the mapped weights in place, nothing is copied until training writes to a page
+    // a file saved in another precision (or into master weights) or in the old layout is converted instead
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
+    {
+        Layer<T> &layer = network[index_layer];
+        const ModelLayerRecord &record = records[index_layer];
+        char *block = m_model.data() + record.offset;
+        char *biasBlock = hasBiasBlock ? m_model.data() + ModelBiasOffset(record, header->scalarBytes) : nullptr;
+        if (hasBiasBlock && header->scalarBytes == sizeof(T) && record.stride == layer.Stride() && !layer.HasMasterWeights())
+            layer.AttachWeights(reinterpret_cast<T *>(block), reinterpret_cast<T *>(biasBlock));
+        else if (header->scalarBytes == sizeof(double))
+            layer.LoadWeights(reinterpret_cast<const double *>(block), record.stride, reinterpret_cast<const double *>(biasBlock));
+        else
+            layer.LoadWeights(reinterpret_cast<const float *>(block), record.stride, reinterpret_cast<const float *>(biasBlock));
+    }
+    // inference has to scale its inputs exactly like the training data was scaled
+    m_normalizer.Clear();
+    if (header->normInputs != 0)
+    {
+        const double *block = reinterpret_cast<const double *>(m_model.data() + header->normOffset);
+        m_normalizer.Load(block, block + header->normInputs, header->normInputs);
+    }
+    std::cout << "Weights imported from : " << path << std::endl;
+}
+
+template <typename T, typename Policy>
+unsigned int NeuralNetwork::TrainLoop(const MatrixView<T> &in, const std::vector<unsigned int> &labels, std::vector<unsigned int> &order,
+                                      unsigned int batchsize, Validator<T> *validator, std::size_t numValidation)
+{
+    std::vector<Layer<T>> &network = State<T>().network;
+    unsigned int training_pass = 1U;
+    unsigned int size = order.size();
+    PROFILE_EPOCH(0U); // everything before the first epoch, reading the dataset included
+    // either epoch ended or the validation accuracy reached the threshold
     while (training_pass < m_config.epoch)
     {
-        std::cout << "Training Pass: " << training_pass << std::endl;
-        for (auto i = 0; i < size; ++i)
+        // a fresh sample order every epoch, only the indices move
+        if (training_pass > 1)
+            std::shuffle(order.begin(), order.end(), m_rng);
+        if (batchsize > 1)
+        {
+            // one weight update per batch, the last batch may be smaller
+            for (auto i = 0; i < size; i += batchsize)
+            {
+                unsigned int rows = std::min(batchsize, size - i);
+                TrainBatch<T, Policy>(in, labels, order.data() + i, rows); // counts its own allocations, per worker
+                PROFILE_SCOPE(PHASE_LOGGING);
+                m_reporter->SamplesDone(training_pass, i + rows, m_recentAverageError);
+            }
+        }
+        else
         {
-            FeedForward(in[i]);
-            PrintIntermediateOutput(out[i]);
-            BackPropagate(out[i]);
-            // Report how well the training is working, average over recent samples
-            std::cout << "Avg error: " << m_recentAverageError << std::endl;
+            for (auto i = 0; i < size; ++i)
+            {
+                {
+                    COUNT_ALLOCATIONS(m_stepAllocations);
+                    FeedForward<T, Policy>(in[order[i]]);
+                    BackPropagate<T, Policy>(labels[order[i]]);
+                }
+                // Report how well the training is working, average over recent samples
+                PROFILE_SCOPE(PHASE_LOGGING);
+                m_reporter->SamplesDone(training_pass, i + 1, m_recentAverageError);
+            }
         }
+        {
+            PROFILE_SCOPE(PHASE_LOGGING);
+            m_reporter->EpochDone(training_pass, size, m_recentAverageError);
+        }
+        PROFILE_EPOCH(training_pass);
+        bool isDone = false;
+        if (validator != nullptr)
+        {
+            // collect the finished score first, the snapshot behind it is only replaced by the next Submit()
+            unsigned int validatedPass = 0U;
+            double accuracy = 0.0;
+            if (validator->Poll(validatedPass, accuracy))
+            {
+                m_reporter->Validated(validatedPass, numValidation, accuracy);
+                if (accuracy > m_config.accuracyThreshold)
+                {
+                    // early stopping, keep the weights that reached the threshold
+                    validator->Restore(network);
+                    isDone = true;
+                }
+            }
+            // hand a copy of the weights over every validationInterval epochs, skipped while the last one is scored
+            if (!isDone && training_pass % std::max<unsigned short>(m_config.validationInterval, 1U) == 0)
+                validator->Submit(network, training_pass);
+        }
+        else // no validation set, fall back to the training error
+            isDone = (double)(training_pass + 1) / (double)m_config.epoch > 0.25 && (1 - m_recentAverageError > m_config.accuracyThreshold);
         training_pass++;
-        if ((double)training_pass / (double)m_config.epoch > 0.25 && (1 - m_recentAverageError > m_config.accuracyThreshold))
+        if (isDone)
             break; // threshold termination
     }
-    std::cout << "-----------------------------------------------------" << std::endl;
-    std::cout << "Training ended at Epoch " << training_pass << " with Error of " << m_recentAverageError << "." << std::endl;
-    std::cout << "-----------------------------------------------------" << std::endl;
+    return training_pass;
+}
+
+template <typename T>
+bool NeuralNetwork::IsUniformActivation(const std::vector<Layer<T>> &network) const
+{
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
+        if (network[index_layer].Function() != m_config.activationFunction)
+            return false;
+    return true;
 }
 
 // @todo check for bias flag
-void NeuralNetwork::InitNetwork()
+template <typename T>
+void NeuralNetwork::InitNetwork(std::size_t extraBytes)
 {
     // sanity check
     if (m_config.topology.empty())
@@ -97,95 +580,354 @@ void NeuralNetwork::InitNetwork()
         std::cerr << "Topology not recognized! " << std::endl;
         exit(-1);
     }
+    if (!m_config.layerActivations.empty() && m_config.layerActivations.size() != m_config.topology.size() - 1)
+    {
+        std::cerr << "Layer activations mismatched! Expected " << m_config.topology.size() - 1 << " Elements, Found " << m_config.layerActivations.size() << "." << std::endl;
+        exit(-1);
+    }
+    // softmax normalizes a whole layer against the one-hot target, it only makes sense at the output
+    bool isHiddenSoftmax = m_config.activationFunction == SOFTMAX && m_config.layerActivations.empty() && m_config.topology.size() > 2;
+    for (auto index_layer = 0; index_layer + 1 < m_config.layerActivations.size(); ++index_layer)
+        isHiddenSoftmax |= m_config.layerActivations[index_layer] == SOFTMAX;
+    if (isHiddenSoftmax)
+    {
+        std::cerr << "Softmax is only supported on the output layer! " << std::endl;
+        exit(-1);
+    }
 
     unsigned int layerSize = m_config.topology.size();
+    std::vector<Layer<T>> &network = State<T>().network;
+    // everything borrowed from the arena goes before it is refilled
+    State<T>().predictWorkspaces.clear();
+    State<T>().workspaces.clear();
+    network.clear();
+    network.reserve(layerSize);
+    std::size_t bytes = extraBytes;
+    for (auto index_layer = 0; index_layer < layerSize; ++index_layer)
+        bytes += Layer<T>::ArenaBytes(m_config.topology[index_layer], index_layer ? m_config.topology[index_layer - 1] : 0, Precision() == MIXED_PRECISION,
+                                      OptimizerStates(static_cast<OPTIMIZER>(m_config.optimizer)));
+    Arena &arena = State<T>().arena;
+    arena.Reserve(bytes);
     for (auto index_layer = 0; index_layer < layerSize; ++index_layer)
     {
-        m_network.emplace_back(Layer());
-        auto numOutput = (index_layer == layerSize - 1) ? 0 : m_config.topology[index_layer + 1];
-        // Add a bias neuron in each layer.
-        for (auto index_neuron = 0; index_neuron <= m_config.topology[index_layer]; ++index_neuron)
-            m_network.back().emplace_back(Neuron(numOutput, index_neuron));
+        // each layer owns the weights coming into it, the input layer has none
+        auto numInput = (index_layer == 0) ? 0 : m_config.topology[index_layer - 1];
+        // per layer activation when given, otherwise every hidden layer uses the global one
+        auto function = (index_layer == 0 || m_config.layerActivations.empty()) ? m_config.activationFunction
+                                                                                : m_config.layerActivations[index_layer - 1];
+        if (index_layer == layerSize - 1 && m_config.layerActivations.empty())
+            function = m_config.outputActivation;
+        network.emplace_back(Layer<T>(m_config.topology[index_layer], numInput, m_config.bias, static_cast<FUNCTION>(function), &arena));
+        if (Precision() == MIXED_PRECISION)
+            network.back().EnableMasterWeights();
+        network.back().EnableOptimizer(static_cast<OPTIMIZER>(m_config.optimizer));
+        network.back().RandomizeWeights(m_rng);
     }
-    // Force the bias node's output to a value
-    m_network.back().back().SetOutputVal(m_config.bias);
 }
 
-void NeuralNetwork::FeedForward(const std::vector<double> &in)
+template <typename T, typename Policy>
+void NeuralNetwork::FeedForward(std::span<const T> in)
 {
+    std::vector<Layer<T>> &network = State<T>().network;
     // sanity check
-    if (in.size() != m_network.front().size() - 1)
+    if (in.size() != network.front().size())
     {
         std::cerr << "Input size mismatched! " << std::endl;
         exit(-1);
     }
-    // Assign (latch) the input values into the input neurons
-    for (unsigned i = 0; i < in.size(); ++i)
-        m_network[0][i].SetOutputVal(in[i]);
+    {
+        // Assign (latch) the input values into the input neurons
+        PROFILE_SCOPE(PHASE_DATA_ACCESS);
+        PROFILE_COUNT(PHASE_DATA_ACCESS, 0U, in.size_bytes(), 1U);
+        std::copy(in.begin(), in.end(), network.front().Outputs());
+    }
 
     // forward propagate
-    for (auto index_layer = 1; index_layer < m_network.size(); ++index_layer)
+    PROFILE_SCOPE(PHASE_FEED_FORWARD);
+    PROFILE_COUNT(PHASE_FEED_FORWARD, ForwardFlops(network), WeightBytes(network), 1U);
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
     {
-        Layer &prevLayer = m_network[index_layer - 1];
-        for (auto n = 0; n < m_network[index_layer].size() - 1; ++n)
-            m_network[index_layer][n].FeedForward(prevLayer, m_config.activationFunction);
+        Layer<T> &layer = network[index_layer];
+        Policy::Apply(layer, [&]<FUNCTION F>()
+                      { layer.template FeedForward<F>(network[index_layer - 1]); });
     }
 }
 
-void NeuralNetwork::BackPropagate(const std::vector<double> &out)
+template <typename T, typename Policy>
+void NeuralNetwork::BackPropagate(unsigned int label)
 {
-    // sanity check
-    if (out.size() != m_network.back().size() - 1)
+    std::vector<Layer<T>> &network = State<T>().network;
     {
-        std::cerr << "Output size mismatched! " << std::endl;
-        exit(-1);
+        PROFILE_SCOPE(PHASE_BACK_PROPAGATE);
+        // the hidden gradients read every weight but the first layer's once more
+        PROFILE_COUNT(PHASE_BACK_PROPAGATE, ForwardFlops(network) - 2ULL * network[1].size() * (network[1].NumInputs() + 1),
+                      WeightBytes(network) - network[1].size() * network[1].Stride() * sizeof(T), 1U);
+        // Calculate output layer gradients and the overall net error in one pass, target is the one-hot of label
+        // the error is the RMS of output neuron errors, or the cross-entropy for a softmax output
+        Layer<T> &outputLayer = network.back();
+        Policy::Apply(outputLayer, [&]<FUNCTION F>()
+                      { m_error = outputLayer.template CalcOutputGradients<F>(label); });
+
+        // Implement a recent average measurement
+        m_recentAverageError =
+            (m_recentAverageError * m_recentAverageSmoothingFactor + m_error) / (m_recentAverageSmoothingFactor + 1.0);
+
+        // Calculate hidden layer gradients
+        for (auto index_layer = network.size() - 2; index_layer > 0; --index_layer)
+        {
+            Layer<T> &hiddenLayer = network[index_layer];
+            Policy::Apply(hiddenLayer, [&]<FUNCTION F>()
+                          { hiddenLayer.template CalcHiddenGradients<F>(network[index_layer + 1]); });
+        }
+    }
+
+    // For all layers from outputs to first hidden layer,
+    // update connection weights, every weight and its optimizer state is read and written once
+    PROFILE_SCOPE(PHASE_WEIGHT_UPDATE);
+    PROFILE_COUNT(PHASE_WEIGHT_UPDATE, 2 * ForwardFlops(network), 2 * (1 + OptimizerStates(static_cast<OPTIMIZER>(m_config.optimizer))) * WeightBytes(network), 1U);
+    const OptimizerStep step = NextOptimizerStep();
+    for (auto index_layer = network.size() - 1; index_layer > 0; --index_layer)
+        network[index_layer].UpdateInputWeights(network[index_layer - 1], step);
+}
+
+template <typename T, typename Policy>
+void NeuralNetwork::TrainBatch(const MatrixView<T> &in, const std::vector<unsigned int> &labels, const unsigned int *indices, unsigned int rows)
+{
+    std::vector<Layer<T>> &network = State<T>().network;
+    std::vector<BatchWorkspace<T>> &workspaces = State<T>().workspaces;
+    const unsigned int numWorkers = m_pool->size();
+    const unsigned int shard = (rows + numWorkers - 1) / numWorkers;
+    m_pool->Run([&](unsigned int worker)
+                {
+                    COUNT_ALLOCATIONS(m_stepAllocations);
+                    // every worker runs its shard through its own workspace, the weights are only read
+                    BatchWorkspace<T> &ws = workspaces[worker];
+                    unsigned int begin = std::min(rows, worker * shard);
+                    unsigned int count = std::min(rows, begin + shard) - begin;
+                    {
+                        PROFILE_SCOPE(PHASE_DATA_ACCESS);
+                        PROFILE_COUNT(PHASE_DATA_ACCESS, 0U, count * network.front().size() * sizeof(T), count);
+                        for (auto r = 0; r < count; ++r)
+                        {
+                            // Assign (latch) the shard into the input layer, one row per sample
+                            std::span<const T> sample = in[indices[begin + r]];
+                            if (sample.size() != network.front().size())
+                            {
+                                std::cerr << "Input size mismatched! " << std::endl;
+                                exit(-1);
+                            }
+                            std::copy(sample.begin(), sample.end(), ws[0].Outputs(r));
+                        }
+                    }
+                    {
+                        // the weights are streamed once per batch, not once per sample
+                        PROFILE_SCOPE(PHASE_FEED_FORWARD);
+                        PROFILE_COUNT(PHASE_FEED_FORWARD, count * ForwardFlops(network), WeightBytes(network), count);
+                        FeedForwardBatch<T, Policy>(network, ws, count);
+                    }
+                    {
+                        PROFILE_SCOPE(PHASE_BACK_PROPAGATE);
+                        // hidden gradients plus the weight gradient sums, both a product the size of the forward one
+                        PROFILE_COUNT(PHASE_BACK_PROPAGATE, 2 * count * ForwardFlops(network), 2 * WeightBytes(network), count);
+                        BackPropagateBatch<T, Policy>(ws, labels, indices + begin, count);
+                    }
+                    // tree reduction of the weight gradients, log2(workers) steps into worker 0
+                    for (unsigned int step = 1; step < numWorkers; step <<= 1)
+                    {
+                        m_pool->Sync();
+                        if (worker % (2 * step) == 0 && worker + step < numWorkers)
+                            ws.AccumulateWeightGradients(workspaces[worker + step]);
+                    } });
+
+    COUNT_ALLOCATIONS(m_stepAllocations);
+    {
+        // a single averaged update with the reduced gradients
+        PROFILE_SCOPE(PHASE_WEIGHT_UPDATE);
+        PROFILE_COUNT(PHASE_WEIGHT_UPDATE, 2 * ForwardFlops(network), (3 + 2 * OptimizerStates(static_cast<OPTIMIZER>(m_config.optimizer))) * WeightBytes(network), rows);
+        const OptimizerStep step = NextOptimizerStep();
+        for (auto index_layer = network.size() - 1; index_layer > 0; --index_layer)
+            network[index_layer].ApplyWeightGradients(workspaces[0][index_layer].weightGradients.data(), workspaces[0][index_layer].biasGradients.data(),
+                                                       step, 1.0 / rows);
+    }
+
+    // Implement a recent average measurement, in sample order
+    for (auto worker = 0; worker < numWorkers; ++worker)
+    {
+        unsigned int begin = std::min(rows, worker * shard);
+        unsigned int count = std::min(rows, begin + shard) - begin;
+        for (auto r = 0; r < count; ++r)
+        {
+            m_error = workspaces[worker].SampleErrors()[r];
+            m_recentAverageError =
+                (m_recentAverageError * m_recentAverageSmoothingFactor + m_error) / (m_recentAverageSmoothingFactor + 1.0);
+        }
     }
-    // Calculate overall net error (RMS of output neuron errors)
-    Layer &outputLayer = m_network.back();
-    m_error = 0.0;
+}
 
-    for (auto n = 0; n < outputLayer.size() - 1; ++n)
+template <typename T, typename Policy>
+void NeuralNetwork::FeedForwardBatch(const std::vector<Layer<T>> &network, BatchWorkspace<T> &ws, unsigned int rows) const
+{
+    // forward propagate, one matrix-matrix product per layer
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
     {
-        double delta = out[n] - outputLayer[n].GetOutputVal();
-        m_error += delta * delta;
+        const Layer<T> &layer = network[index_layer];
+        Policy::Apply(layer, [&]<FUNCTION F>()
+                      { layer.template FeedForwardBatch<F>(ws[index_layer - 1], ws[index_layer], rows); });
     }
-    m_error /= outputLayer.size() - 1; // get average error squared
-    m_error = sqrt(m_error);           // RMS
+}
+
+template <typename T, typename Policy>
+void NeuralNetwork::BackPropagateBatch(BatchWorkspace<T> &ws, const std::vector<unsigned int> &labels, const unsigned int *indices, unsigned int rows) const
+{
+    const std::vector<Layer<T>> &network = State<T>().network;
+    const std::size_t last = network.size() - 1;
+    const Layer<T> &outputLayer = network.back();
+    for (auto r = 0; r < rows; ++r)
+        ws.Labels()[r] = labels[indices[r]];
 
-    // Implement a recent average measurement
-    m_recentAverageError =
-        (m_recentAverageError * m_recentAverageSmoothingFactor + m_error) / (m_recentAverageSmoothingFactor + 1.0);
+    // Calculate output and hidden layer gradients for the whole batch
+    // the loss of every sample is written alongside, folded into the recent average by the caller
+    Policy::Apply(outputLayer, [&]<FUNCTION F>()
+                  { outputLayer.template CalcOutputGradientsBatch<F>(ws[last], ws.Labels(), ws.SampleErrors(), rows); });
+    for (auto index_layer = last - 1; index_layer > 0; --index_layer)
+    {
+        const Layer<T> &hiddenLayer = network[index_layer];
+        Policy::Apply(hiddenLayer, [&]<FUNCTION F>()
+                      { hiddenLayer.template CalcHiddenGradientsBatch<F>(network[index_layer + 1], ws[index_layer + 1], ws[index_layer], rows); });
+    }
 
-    // Calculate output layer gradients
-    for (auto m = 0; m < outputLayer.size() - 1; ++m)
-        outputLayer[m].CalcOutputGradients(out[m], m_config.activationFunction);
+    // Sum the weight gradients over the rows of this workspace
+    for (auto index_layer = last; index_layer > 0; --index_layer)
+        network[index_layer].CalcWeightGradients(ws[index_layer - 1], ws[index_layer], rows);
+}
 
-    // Calculate hidden layer gradients
-    for (auto index_layer = m_network.size() - 2; index_layer > 0; --index_layer)
+template <typename T>
+double NeuralNetwork::Accuracy(const std::vector<Layer<T>> &network, BatchWorkspace<T> &ws, const MatrixView<T> &in,
+                               const std::vector<unsigned int> &labels, std::span<const unsigned int> indices) const
+{
+    if (indices.empty())
+        return 0.0;
+    const std::size_t last = network.size() - 1;
+    const unsigned int outSize = network.back().size();
+    const bool isUniform = IsUniformActivation(network);
+    std::size_t correct = 0U;
+    for (std::size_t first = 0; first < indices.size(); first += ws.Capacity())
     {
-        Layer &hiddenLayer = m_network[index_layer];
-        Layer &nextLayer = m_network[index_layer + 1];
-        for (auto i = 0; i < hiddenLayer.size(); ++i)
-            hiddenLayer[i].CalcHiddenGradients(nextLayer, m_config.activationFunction);
+        const unsigned int rows = std::min<std::size_t>(ws.Capacity(), indices.size() - first);
+        // the dataset rows are already normalized
+        for (auto r = 0; r < rows; ++r)
+        {
+            std::span<const T> sample = in[indices[first + r]];
+            std::copy(sample.begin(), sample.end(), ws[0].Outputs(r));
+        }
+        if (isUniform)
+            DispatchActivation(static_cast<FUNCTION>(m_config.activationFunction), [&]<FUNCTION F>()
+                               { FeedForwardBatch<T, UniformActivation<F>>(network, ws, rows); });
+        else
+            FeedForwardBatch<T, PerLayerActivation>(network, ws, rows);
+        for (auto r = 0; r < rows; ++r)
+        {
+            const T *result = ws[last].Outputs(r);
+            correct += (std::max_element(result, result + outSize) - result) == labels[indices[first + r]];
+        }
     }
+    return static_cast<double>(correct) / indices.size();
+}
 
-    // For all layers from outputs to first hidden layer,
-    // update connection weights
-    for (auto index_layer = m_network.size() - 1; index_layer > 0; --index_layer)
+bool NeuralNetwork::Predict(std::span<const double> inputs, std::size_t batch, std::span<double> outputs) const
+{
+    return DispatchPrecision(Precision(), [&]<typename T>()
+                             { return PredictRows<T>(inputs, batch, outputs); });
+}
+
+bool NeuralNetwork::Predict(std::span<const float> inputs, std::size_t batch, std::span<float> outputs) const
+{
+    return DispatchPrecision(Precision(), [&]<typename T>()
+                             { return PredictRows<T>(inputs, batch, outputs); });
+}
+
+template <typename T, typename S>
+bool NeuralNetwork::PredictRows(std::span<const S> inputs, std::size_t batch, std::span<S> outputs) const
+{
+    const std::vector<Layer<T>> &network = State<T>().network;
+    if (network.empty())
+        return false;
+    const unsigned int inSize = network.front().size();
+    const unsigned int outSize = network.back().size();
+    if (inputs.size() < batch * inSize || outputs.size() < batch * outSize)
+        return false;
+
+    // the weights are only read, every concurrent call works in its own workspace
+    std::unique_ptr<BatchWorkspace<T>> ws = AcquireWorkspace<T>();
+    const std::size_t last = network.size() - 1;
+    const bool isUniform = IsUniformActivation(network);
+    for (std::size_t first = 0; first < batch; first += ws->Capacity())
     {
-        Layer &layer = m_network[index_layer];
-        Layer &prevLayer = m_network[index_layer - 1];
-        for (auto j = 0; j < layer.size() - 1; ++j)
-            layer[j].UpdateInputWeights(prevLayer, m_config.learning_rate, m_config.momentum);
+        const unsigned int rows = std::min<std::size_t>(ws->Capacity(), batch - first);
+        // latching converts the caller's scalar type into the network's
+        for (auto r = 0; r < rows; ++r)
+        {
+            const S *sample = inputs.data() + (first + r) * inSize;
+            std::copy(sample, sample + inSize, (*ws)[0].Outputs(r));
+        }
+        m_normalizer.Transform((*ws)[0].Outputs(0), (*ws)[0].outStride, rows);
+        if (isUniform)
+            DispatchActivation(static_cast<FUNCTION>(m_config.activationFunction), [&]<FUNCTION F>()
+                               { FeedForwardBatch<T, UniformActivation<F>>(network, *ws, rows); });
+        else
+            FeedForwardBatch<T, PerLayerActivation>(network, *ws, rows);
+        for (auto r = 0; r < rows; ++r)
+        {
+            const T *result = (*ws)[last].Outputs(r);
+            std::copy(result, result + outSize, outputs.data() + (first + r) * outSize);
+        }
     }
+    ReleaseWorkspace(std::move(ws));
+    return true;
 }
 
-void NeuralNetwork::PrintIntermediateOutput(const std::vector<double> &out) const
+template <typename T>
+std::unique_ptr<BatchWorkspace<T>> NeuralNetwork::AcquireWorkspace() const
 {
-    for (auto i = 0; i < m_network.back().size() - 1; ++i)
     {
-        std::cout << std::setprecision(4) << "Predict(" << m_network.back()[i].GetOutputVal() << ") Actual(" << out[i] << ")\t";
+        std::lock_guard<std::mutex> lock(m_predictMutex);
+        std::vector<std::unique_ptr<BatchWorkspace<T>>> &idle = State<T>().predictWorkspaces;
+        if (!idle.empty())
+        {
+            std::unique_ptr<BatchWorkspace<T>> ws = std::move(idle.back());
+            idle.pop_back();
+            return ws;
+        }
     }
+    // only when more calls run at once than ever before, later calls reuse it
+    return std::make_unique<BatchWorkspace<T>>(State<T>().network, PREDICT_BATCH, false);
+}
+
+template <typename T>
+void NeuralNetwork::ReleaseWorkspace(std::unique_ptr<BatchWorkspace<T>> ws) const
+{
+    std::lock_guard<std::mutex> lock(m_predictMutex);
+    State<T>().predictWorkspaces.push_back(std::move(ws));
+}
+
+void NeuralNetwork::Load()
+{
+    DispatchPrecision(Precision(), [&]<typename T>()
+                      {
+                          InitNetwork<T>();
+                          if (!m_config.importWeightPath.empty())
+                              ImportNetwork<T>(); });
+}
+
+void NeuralNetwork::PrintIntermediateOutput(const std::vector<double> &out) const
+{
+    DispatchPrecision(Precision(), [&]<typename T>()
+                      {
+                          const Layer<T> &outputLayer = State<T>().network.back();
+                          for (auto i = 0; i < outputLayer.size(); ++i)
+                          {
+                              std::cout << std::setprecision(4) << "Predict(" << outputLayer.Outputs()[i] << ") Actual(" << out[i] << ")\t";
+                          } });
 }
 
 void NeuralNetwork::PrintConfig() const
@@ -201,18 +943,40 @@ void NeuralNetwork::PrintConfig() const
     for (auto layer : m_config.topology)
         std::cout << layer << " ";
     std::cout << "]" << std::endl;
-    std::cout << "Training Split \t: " << m_config.training_split << std::endl;
+    std::cout << "Validation Split: " << m_config.training_split << " (every " << m_config.validationInterval << " Epochs)" << std::endl;
+    std::cout << "Test Split \t: " << m_config.test_split << std::endl;
     std::cout << "Learning Rate \t: " << m_config.learning_rate << std::endl;
     std::cout << "Momentum \t: " << m_config.momentum << std::endl;
+    std::cout << "Optimizer \t: " << m_config.optimizer << " (0:SGD, 1:Nesterov, 2:RMSProp, 3:Adam, 4:AdamW)" << std::endl;
+    if (m_config.optimizer >= RMSPROP)
+        std::cout << "Beta1/Beta2/Eps : " << m_config.beta1 << " / " << m_config.beta2 << " / " << m_config.epsilon << std::endl;
+    std::cout << "Weight Decay \t: " << m_config.weightDecay << std::endl;
     std::cout << "Bias Value\t: " << m_config.bias << std::endl;
     std::cout << "Activation \t: " << m_config.activationFunction << " (0:Sigmoid , 1:Tanh, 2:ReLu, 3:Linear)" << std::endl;
+    std::cout << "Output Act. \t: " << m_config.outputActivation << " (0:Sigmoid , 1:Tanh, 2:ReLu, 3:Linear, 4:Softmax)" << std::endl;
+    if (!m_config.layerActivations.empty())
+    {
+        std::cout << "Layer Activation: [ ";
+        for (auto function : m_config.layerActivations)
+            std::cout << function << " ";
+        std::cout << "]" << std::endl;
+    }
     std::cout << "Epoch \t\t: " << m_config.epoch << std::endl;
     std::cout << "Threshold \t: " << m_config.accuracyThreshold << std::endl;
-    // std::string isBatch = (m_config.isBatchLearning) ? "Yes" : "No";
-    // std::cout << "Batch Learning \t: " << isBatch << std::endl;
-    // std::cout << "Batch Size \t: " << m_config.batchsize << std::endl;
-    // std::string isRegularized = (m_config.isRegularized) ? "Yes" : "No";
-    // std::cout << "Regularized \t: " << isRegularized << std::endl;
-    // std::cout << "Reg Rate \t: " << m_config.regularizationRate << std::endl;
+    std::string isBatch = (m_config.isBatchLearning) ? "Yes" : "No";
+    std::cout << "Batch Learning \t: " << isBatch << std::endl;
+    std::cout << "Batch Size \t: " << m_config.batchsize << std::endl;
+    std::cout << "Threads \t: " << m_config.threads << std::endl;
+    std::cout << "Seed \t\t: " << m_config.seed << " (0:Random)" << std::endl;
+    std::cout << "Precision \t: " << m_config.precision << " (0:Double, 1:Float, 2:Mixed)" << std::endl;
+#ifdef SNN_PROFILE
+    std::cout << "Trace Path \t: " << m_config.tracePath << " (empty prints the summary only)" << std::endl;
+#endif
+    if (!m_config.quantizedExportPath.empty())
+        std::cout << "Quantized Export: " << m_config.quantizedExportPath << " (" << m_config.calibrationSamples << " Calibration Samples)" << std::endl;
+    std::cout << "Normalization \t: " << m_config.normalization << " (0:None, 1:Standardize, 2:Min-Max)" << std::endl;
+    std::cout << "Verbosity \t: " << m_config.verbosity << " (0:Quiet, 1:Per Epoch, 2:Every " << m_config.reportInterval << " Samples)" << std::endl;
+    std::cout << "Regularized \t: " << m_config.regularization << " (0:None, 1:L1, 2:L2)" << std::endl;
+    std::cout << "Reg Rate \t: " << m_config.regularizationRate << std::endl;
     std::cout << "-----------------------------------------------------" << std::endl;
 }
\ No newline at end of file
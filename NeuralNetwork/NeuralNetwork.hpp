@@ -2,35 +2,75 @@
 #ifndef NEURALNETWORK_H
 #define NEURALNETWORK_H
 
+#include <atomic>
+#include <mutex>
+#include <span>
 #include <string>
 #include <vector>
 #include "json.hpp"
-#include "Neuron.hpp"
+#include "Layer.hpp"
+#include "MappedFile.hpp"
+#include "Optimizer.hpp"
+#include "Precision.hpp"
+#include "ProgressReporter.hpp"
+#include "ThreadPool.hpp"
+#include "Validator.hpp"
+#include "Workspace.hpp"
 #include "Dataset.hpp"
 
 using json = nlohmann::json;
 
 #define NUM_CONFIG 12
+#define PREDICT_BATCH 64U // rows per forward pass in Predict
 
 struct NetworkConfig
 {
     // Default config values
     std::string datasetPath = "/Dataset/dataset.csv";
     std::string tokenPath = "/Dataset/dataset.json";
-    std::string importWeightPath = "/Trained/weights.csv";
-    std::string exportWeightPath = "/Trained/weights.csv";
+    std::string importWeightPath = "/Trained/model.bin"; // binary model, see ModelFormat.hpp
+    std::string exportWeightPath = "/Trained/model.bin";
     std::vector<unsigned short> topology{2, 2, 2};
-    double training_split = 0.15;
+    double training_split = 0.15; // fraction of the rows held out for validation
+    double test_split = 0.15;     // fraction of the rows held out for the final test
     double learning_rate = 0.15;
     double momentum = 0.5;
+    unsigned short optimizer = SGD; // update rule, see OPTIMIZER
+    double beta1 = 0.9;             // ADAM/ADAMW decay of the gradient mean
+    double beta2 = 0.999;           // ADAM/ADAMW/RMSPROP decay of the squared gradient mean
+    double epsilon = 1e-8;
+    double weightDecay = 0.0;       // decoupled, every optimizer, 0.01 when not given with ADAMW
     double bias = 0.5;
     unsigned short activationFunction = 0U;
     unsigned short epoch = 1000U; // short so epoch capped at 65535
     double accuracyThreshold = 0.85;
-    // bool isBatchLearning = false;
-    // unsigned short batchsize = 10U;
-    // bool isRegularized = false;
-    // double regularizationRate = 0.5;
+    bool isBatchLearning = false;
+    unsigned short batchsize = 10U;
+    std::vector<unsigned short> layerActivations{}; // optional, one per layer after the input layer
+    unsigned short outputActivation = 0U;           // output layer when layerActivations is empty, SOFTMAX trains on cross-entropy
+    unsigned short threads = 1U;                    // data-parallel workers, batch learning only
+    unsigned short verbosity = PER_EPOCH;           // see VERBOSITY
+    unsigned int reportInterval = 100U;             // samples between reports when verbosity is PER_SAMPLES
+    unsigned int seed = 0U;                         // seeds shuffling and weight init, 0 picks a random seed
+    unsigned short normalization = NO_NORMALIZATION; // input scaling, see NORMALIZATION
+    unsigned short validationInterval = 1U;          // epochs between validation passes
+    unsigned short precision = DOUBLE_PRECISION;     // scalar type of weights, activations and dataset, see PRECISION
+    std::string quantizedExportPath = "";            // int8 inference model written after training, empty to skip
+    unsigned int calibrationSamples = 256U;          // training rows the int8 input ranges are measured on
+    std::string tracePath = "";                      // Chrome trace of the hot path, only written when built with SNN_PROFILE
+    unsigned short regularization = NO_REGULARIZATION; // penalty added to the weight gradients, see REGULARIZATION
+    double regularizationRate = 0.0;
+};
+
+// everything whose scalar type follows the configured precision, only the configured one gets filled
+template <typename T>
+struct NetworkState
+{
+    Arena arena; // backs network and workspaces, declared first so it goes last
+    std::unique_ptr<Dataset<T>> dataset = nullptr;
+    std::vector<Layer<T>> network;             // network[layerIndex][neuronIndex]
+    std::vector<BatchWorkspace<T>> workspaces; // one per worker of m_pool
+    mutable std::vector<std::unique_ptr<BatchWorkspace<T>>> predictWorkspaces; // idle inference workspaces
 };
 
 /* @brief
@@ -42,19 +82,31 @@ class NeuralNetwork
 public:
     NeuralNetwork(const std::string &path) : m_configPath(path)
     {
-        ptr_ds = std::make_unique<Dataset>();
         ParseConfig();
     };
 
     // Core Functionsk
     void Train(); // other context may call it Fit()
-    // @todo predict and export weights
-    void Predict();
-    void ExportWeights();
+    // Run a forward pass over batch rows of raw inputs (row-major, input layer width each) and write
+    // the output layer values (row-major, output layer width each) into outputs
+    // Read-only on the network and safe to call from many threads at once,
+    // workspaces are reused across calls so a warmed up call does not allocate
+    // returns false when the network is not built or a buffer is too small
+    bool Predict(std::span<const double> inputs, std::size_t batch, std::span<double> outputs) const;
+    // same in float, nothing is converted when the network runs in float
+    bool Predict(std::span<const float> inputs, std::size_t batch, std::span<float> outputs) const;
+    void Load(); // build the network and import importWeightPath, for inference without training
+    void ExportWeights(); // write the trained network to exportWeightPath
+    void ImportWeights(); // memory map importWeightPath and use its weights in place, converted when its precision differs
+    void ExportQuantized(); // calibrate on the training rows and write the int8 model to quantizedExportPath, see QuantizedNetwork
 
     // Utility Functions
     void PrintConfig() const;                                                   // Debugging, Read-Only
-    inline void PrintDataset(DataType type) const { ptr_ds->PrintData(type); }; // Debugging, Read-Only
+    inline void PrintDataset(DataType type) const // Debugging, Read-Only
+    {
+        DispatchPrecision(Precision(), [&]<typename T>()
+                          { State<T>().dataset->PrintData(type); });
+    };
     void PrintIntermediateOutput(const std::vector<double> &out) const;         // Debugging, Read-Only
 
     // Getters & Setter
@@ -63,17 +115,81 @@ public:
 private:
     std::string m_configPath = "";
     NetworkConfig m_config{};
-    std::unique_ptr<Dataset> ptr_ds = nullptr;
+    std::mt19937 m_rng; // every random draw goes through this, a fixed seed makes runs reproducible
 
-    Matrix2D<Neuron> m_network; // m_network[layerIndex][neuronIndex]
+    NetworkState<double> m_double; // DOUBLE_PRECISION
+    NetworkState<float> m_single;  // SINGLE_PRECISION and MIXED_PRECISION
+    MappedFile m_model;            // imported model, layers may point straight into it
+    Normalizer m_normalizer;       // input scaling the weights were trained with, applied by Predict
     double m_error = 0.0;
     double m_recentAverageError = 0.0;
     const double m_recentAverageSmoothingFactor = 100;
+    std::unique_ptr<ThreadPool> m_pool = nullptr;
+    std::unique_ptr<ProgressReporter> m_reporter = nullptr;
+    mutable std::mutex m_predictMutex;
+    std::atomic<std::uint64_t> m_stepAllocations{0U}; // heap allocations inside training steps, only counted with SNN_COUNT_ALLOCATIONS
+    unsigned long m_updateSteps = 0UL;                 // weight updates since training started
+
+    inline PRECISION Precision() const { return static_cast<PRECISION>(m_config.precision); }
+    // hyperparameters of the next weight update, counts it
+    OptimizerStep NextOptimizerStep();
+    template <typename T>
+    inline NetworkState<T> &State()
+    {
+        if constexpr (std::is_same_v<T, float>)
+            return m_single;
+        else
+            return m_double;
+    }
+    template <typename T>
+    inline const NetworkState<T> &State() const
+    {
+        if constexpr (std::is_same_v<T, float>)
+            return m_single;
+        else
+            return m_double;
+    }
 
+    // T is the scalar type of the network state every function below works on
     void ParseConfig();
-    void InitNetwork();
-    void FeedForward(const std::vector<double> &in);
-    void BackPropagate(const std::vector<double> &out);
+    template <typename T>
+    void TrainNetwork();
+    template <typename T>
+    void InitNetwork(std::size_t extraBytes = 0U); // extraBytes of arena left for workspaces
+    template <typename T>
+    void ExportNetwork();
+    template <typename T>
+    void ImportNetwork();
+    template <typename T>
+    void ExportQuantizedNetwork();
+    template <typename T, typename S> // S is the scalar type of the caller's buffers
+    bool PredictRows(std::span<const S> inputs, std::size_t batch, std::span<S> outputs) const;
+    template <typename T>
+    bool IsUniformActivation(const std::vector<Layer<T>> &network) const;
+    template <typename T>
+    std::unique_ptr<BatchWorkspace<T>> AcquireWorkspace() const;
+    template <typename T>
+    void ReleaseWorkspace(std::unique_ptr<BatchWorkspace<T>> ws) const;
+    // fraction of the dataset rows indices[] whose largest output is the labelled class, read-only on network
+    template <typename T>
+    double Accuracy(const std::vector<Layer<T>> &network, BatchWorkspace<T> &ws, const MatrixView<T> &in,
+                    const std::vector<unsigned int> &labels, std::span<const unsigned int> indices) const;
+    // Policy selects the activation of each layer (UniformActivation<F> or PerLayerActivation)
+    template <typename T, typename Policy>
+    unsigned int TrainLoop(const MatrixView<T> &in, const std::vector<unsigned int> &labels, std::vector<unsigned int> &order,
+                           unsigned int batchsize, Validator<T> *validator, std::size_t numValidation);
+    template <typename T, typename Policy>
+    void FeedForward(std::span<const T> in);
+    template <typename T, typename Policy>
+    void BackPropagate(unsigned int label);
+    // mini-batch path, dataset rows indices[0, rows) are sharded across the thread pool
+    template <typename T, typename Policy>
+    void TrainBatch(const MatrixView<T> &in, const std::vector<unsigned int> &labels, const unsigned int *indices, unsigned int rows);
+    // forward pass through network (the trained one or a snapshot of it) over the rows already latched into ws[0]
+    template <typename T, typename Policy>
+    void FeedForwardBatch(const std::vector<Layer<T>> &network, BatchWorkspace<T> &ws, unsigned int rows) const;
+    template <typename T, typename Policy>
+    void BackPropagateBatch(BatchWorkspace<T> &ws, const std::vector<unsigned int> &labels, const unsigned int *indices, unsigned int rows) const;
 };
 
 #endif
\ No newline at end of file
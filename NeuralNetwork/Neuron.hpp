@@ -2,41 +2,31 @@
 #ifndef NEURON_H
 #define NEURON_H
 
-#include <vector>
-#include <random>
-
-class Neuron;
-
-struct Connection
-{
-    double weight = 0;
-    double deltaWeight = 0;
-};
-
-typedef std::vector<Neuron> Layer;
-
 /* @brief
- *   Main class for each individual neurons
- *   Takes in the number of output and its index in the layer
+ *   Thin view of one neuron inside its Layer
+ *   The values are owned by the layer, the view only points into the layer's
+ *   output/gradient vectors and into its row of the layer weight matrix
  */
+template <typename T>
 class Neuron
 {
 public:
-    Neuron(unsigned int numOutputs, unsigned int index);
-    inline void SetOutputVal(double val) { m_outputVal = val; }
-    inline double GetOutputVal(void) const { return m_outputVal; }
-    void FeedForward(const Layer &prevLayer, int function);
-    void CalcOutputGradients(double targetVal, int function);
-    void CalcHiddenGradients(const Layer &nextLayer, int function);
-    void UpdateInputWeights(Layer &prevLayer, const double &training_rate, const double &momentum);
+    Neuron(T *output, T *gradient, T *inputWeights, T *biasWeight, unsigned int numInputs)
+        : m_output(output), m_gradient(gradient), m_inputWeights(inputWeights), m_biasWeight(biasWeight), m_numInputs(numInputs){};
+    inline void SetOutputVal(T val) { *m_output = val; }
+    inline T GetOutputVal(void) const { return *m_output; }
+    inline T GetGradient(void) const { return *m_gradient; }
+    // weights from every neuron of the previous layer
+    inline T *GetInputWeights(void) const { return m_inputWeights; }
+    inline T *GetBiasWeight(void) const { return m_biasWeight; }
+    inline unsigned int GetNumInputs(void) const { return m_numInputs; }
 
 private:
-
-    inline double randomWeight(void) { return rand() / double(RAND_MAX); }
-    double m_outputVal = 0;
-    std::vector<Connection> m_outputWeights{};
-    unsigned int m_index = 0U;
-    double m_gradient = 0;
+    T *m_output = nullptr;
+    T *m_gradient = nullptr;
+    T *m_inputWeights = nullptr;
+    T *m_biasWeight = nullptr;
+    unsigned int m_numInputs = 0U;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include <cmath>
+#include <type_traits>
+#include "KernelDispatch.hpp"
+#include "Optimizer.hpp"
+
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define NN_X86_DISPATCH 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+// the update loops are only instantiated inside the target specific wrappers below,
+// so they have to be inlined there to be vectorized for that instruction set
+#define OPTIMIZER_INLINE __attribute__((always_inline)) inline
+#else
+#define OPTIMIZER_INLINE inline
+#endif
+
+namespace
+{
+    // the hyperparameters of a step folded into what the loop multiplies with, once per call
+    // P is the type parameters and state accumulate in, X the type of the gradients
+    template <typename P, typename X>
+    struct Coefficients
+    {
+        X scale;      // gradient = scale * x[i], the learning rate is already in it for SGD and NESTEROV
+        P l1;         // subtracted from it times sign(w), scaled like the gradient
+        P l2;         // subtracted from it times w, scaled like the gradient
+        P momentum;   // SGD, NESTEROV
+        P rate;       // RMSPROP, ADAM (bias corrected)
+        P decay1;     // ADAM gradient mean
+        P gain1;      // 1 - decay1
+        P decay2;     // ADAM, RMSPROP squared gradient mean
+        P gain2;      // 1 - decay2
+        P epsilon;    // ADAM (bias corrected), RMSPROP
+        P shrink;     // 1 - learning rate * weight decay, the weight is scaled by it before the step
+    };
+
+    template <typename P, typename X>
+    Coefficients<P, X> Fold(const OptimizerStep &step, double a)
+    {
+        Coefficients<P, X> k{};
+        k.momentum = static_cast<P>(step.momentum);
+        k.decay1 = static_cast<P>(step.beta1);
+        k.gain1 = static_cast<P>(1.0 - step.beta1);
+        k.decay2 = static_cast<P>(step.beta2);
+        k.gain2 = static_cast<P>(1.0 - step.beta2);
+        k.shrink = static_cast<P>(1.0 - step.learningRate * step.weightDecay);
+        // all three stay neutral when off, which picks the loop without them
+        const double l1 = (step.regularization == L1_REGULARIZATION) ? step.regularizationRate : 0.0;
+        const double l2 = (step.regularization == L2_REGULARIZATION) ? step.regularizationRate : 0.0;
+        if (step.optimizer == SGD || step.optimizer == NESTEROV)
+        {
+            // rate * a rounded once, so every gradient costs a single multiply
+            k.scale = static_cast<X>(step.learningRate * a);
+            k.l1 = static_cast<P>(step.learningRate * l1);
+            k.l2 = static_cast<P>(step.learningRate * l2);
+            return k;
+        }
+        k.scale = static_cast<X>(a);
+        k.l1 = static_cast<P>(l1);
+        k.l2 = static_cast<P>(l2);
+        k.rate = static_cast<P>(step.learningRate);
+        k.epsilon = static_cast<P>(step.epsilon);
+        if (step.optimizer == RMSPROP)
+            return k;
+        // mean / (1 - beta1^t) over sqrt(square / (1 - beta2^t)) + epsilon, with both corrections moved
+        // into the rate and epsilon instead of dividing every moment by them
+        const double t = static_cast<double>(step.step);
+        const double correction2 = std::sqrt(1.0 - std::pow(step.beta2, t));
+        k.rate = static_cast<P>(step.learningRate * correction2 / (1.0 - std::pow(step.beta1, t)));
+        k.epsilon = static_cast<P>(step.epsilon * correction2);
+        return k;
+    }
+
+    // R = false is the loop without penalty and decay, exactly the arithmetic of an unregularized update
+    template <OPTIMIZER O, bool R, typename P, typename X>
+    OPTIMIZER_INLINE void Update(const Coefficients<P, X> &k, P *__restrict w, P *__restrict s0, P *__restrict s1,
+                                 const X *__restrict x, std::size_t n, X *__restrict shadow)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            P g = k.scale * x[i];
+            P weight = w[i];
+            if constexpr (R)
+            {
+                // the gradient points the way the weights move, so the penalties pull towards zero
+                const P sign = P(weight > 0) - P(weight < 0);
+                g -= k.l2 * weight + k.l1 * sign;
+                weight *= k.shrink;
+            }
+            if constexpr (O == SGD)
+            {
+                s0[i] = g + k.momentum * s0[i];
+                w[i] = weight + s0[i];
+            }
+            else if constexpr (O == NESTEROV)
+            {
+                s0[i] = g + k.momentum * s0[i];
+                w[i] = weight + (g + k.momentum * s0[i]);
+            }
+            else if constexpr (O == RMSPROP)
+            {
+                s0[i] = k.decay2 * s0[i] + k.gain2 * g * g;
+                w[i] = weight + k.rate * g / (std::sqrt(s0[i]) + k.epsilon);
+            }
+            else
+            {
+                s0[i] = k.decay1 * s0[i] + k.gain1 * g;
+                s1[i] = k.decay2 * s1[i] + k.gain2 * g * g;
+                w[i] = weight + k.rate * s0[i] / (std::sqrt(s1[i]) + k.epsilon);
+            }
+            // mixed precision, the float weights follow the master weights
+            if constexpr (!std::is_same_v<P, X>)
+                shadow[i] = static_cast<X>(w[i]);
+        }
+    }
+
+    template <bool R, typename P, typename X>
+    OPTIMIZER_INLINE void Dispatch(const Coefficients<P, X> &k, OPTIMIZER optimizer, P *w, P *s0, P *s1, const X *x, std::size_t n,
+                                   X *shadow)
+    {
+        switch (optimizer)
+        {
+        case NESTEROV:
+            Update<NESTEROV, R>(k, w, s0, s1, x, n, shadow);
+            break;
+        case RMSPROP:
+            Update<RMSPROP, R>(k, w, s0, s1, x, n, shadow);
+            break;
+        case ADAM:
+        case ADAMW: // the same rule, the decay is in shrink
+            Update<ADAM, R>(k, w, s0, s1, x, n, shadow);
+            break;
+        default:
+            Update<SGD, R>(k, w, s0, s1, x, n, shadow);
+        }
+    }
+
+    // switch on the update rule and on regularization once per call, each case is its own branch free loop
+    template <typename P, typename X>
+    OPTIMIZER_INLINE void Dispatch(const Coefficients<P, X> &k, OPTIMIZER optimizer, P *w, P *s0, P *s1, const X *x, std::size_t n,
+                                   X *shadow)
+    {
+        if (k.l1 != 0 || k.l2 != 0 || k.shrink != 1)
+            Dispatch<true>(k, optimizer, w, s0, s1, x, n, shadow);
+        else
+            Dispatch<false>(k, optimizer, w, s0, s1, x, n, shadow);
+    }
+
+    template <typename P, typename X>
+    using UpdateFn = void (*)(const Coefficients<P, X> &, OPTIMIZER, P *, P *, P *, const X *, std::size_t, X *);
+
+    // the loops are plain element wise code, each wrapper lets the compiler vectorize them for its instruction set
+#define OPTIMIZER_KERNELS(ISA, TARGET, P, X)                                                                          \
+    TARGET void Update##ISA(const Coefficients<P, X> &k, OPTIMIZER optimizer, P *w, P *s0, P *s1, const X *x, std::size_t n, \
+                            X *shadow)                                                                                \
+    {                                                                                                                 \
+        Dispatch<P, X>(k, optimizer, w, s0, s1, x, n, shadow);                                                        \
+    }
+
+#define OPTIMIZER_KERNELS_ALL(ISA, TARGET)  \
+    OPTIMIZER_KERNELS(ISA, TARGET, double, double) \
+    OPTIMIZER_KERNELS(ISA, TARGET, float, float)   \
+    OPTIMIZER_KERNELS(ISA, TARGET, double, float)
+
+    OPTIMIZER_KERNELS_ALL(Scalar, )
+#ifdef NN_X86_DISPATCH
+    OPTIMIZER_KERNELS_ALL(Avx2, __attribute__((target("avx2,fma"))))
+    OPTIMIZER_KERNELS_ALL(Avx512, __attribute__((target("avx512f"))))
+#endif
+
+    template <typename P, typename X>
+    struct KernelTable
+    {
+        UpdateFn<P, X> update;
+        const char *name;
+    };
+
+    template <typename P, typename X>
+    KernelTable<P, X> SelectKernels()
+    {
+#ifdef NN_X86_DISPATCH
+        __builtin_cpu_init();
+        if (IsaAllowed(ISA_AVX512) && __builtin_cpu_supports("avx512f"))
+            return {static_cast<UpdateFn<P, X>>(UpdateAvx512), "avx512f"};
+        if (IsaAllowed(ISA_AVX2) && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return {static_cast<UpdateFn<P, X>>(UpdateAvx2), "avx2"};
+#endif
+        return {static_cast<UpdateFn<P, X>>(UpdateScalar), "scalar"};
+    }
+
+    // resolved once, on first use
+    template <typename P, typename X>
+    const KernelTable<P, X> &Kernels()
+    {
+        static const KernelTable<P, X> table = SelectKernels<P, X>();
+        return table;
+    }
+
+    template <typename P, typename X>
+    inline void Run(const OptimizerStep &step, P *params, P *state0, P *state1, const X *x, double a, std::size_t n, X *shadow)
+    {
+        if (n == 0)
+            return;
+        Kernels<P, X>().update(Fold<P, X>(step, a), step.optimizer, params, state0, state1, x, n, shadow);
+    }
+}
+
+void OptimizerUpdate(const OptimizerStep &step, double *params, double *state0, double *state1, const double *x, double a, std::size_t n)
+{
+    Run<double, double>(step, params, state0, state1, x, a, n, nullptr);
+}
+
+void OptimizerUpdate(const OptimizerStep &step, float *params, float *state0, float *state1, const float *x, double a, std::size_t n)
+{
+    Run<float, float>(step, params, state0, state1, x, a, n, nullptr);
+}
+
+void OptimizerUpdate(const OptimizerStep &step, double *params, double *state0, double *state1, const float *x, double a, std::size_t n,
+                     float *shadow)
+{
+    Run<double, float>(step, params, state0, state1, x, a, n, shadow);
+}
+
+const char *OptimizerKernelName()
+{
+    return Kernels<double, double>().name;
+}
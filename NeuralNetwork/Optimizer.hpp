@@ -0,0 +1,73 @@
+#pragma once
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <cstddef>
+
+// update rule the layers apply their gradients with
+enum OPTIMIZER
+{
+    SGD = 0,  // momentum, dw = rate * g + momentum * dw, w += dw
+    NESTEROV, // momentum evaluated one step ahead, w += rate * g + momentum * dw
+    RMSPROP,  // rate scaled per weight by a running RMS of its gradient
+    ADAM,     // running mean and RMS of the gradient, bias corrected
+    ADAMW     // ADAM with weight decay on by default
+};
+
+// penalty on the weights added to their gradient before the update rule sees it
+enum REGULARIZATION
+{
+    NO_REGULARIZATION = 0,
+    L1_REGULARIZATION, // rate * sign(w), drives small weights to exactly zero
+    L2_REGULARIZATION  // rate * w
+};
+
+// optimizer state kept per weight, the buffers are laid out like the weights they belong to
+constexpr unsigned int OptimizerStates(OPTIMIZER optimizer)
+{
+    return (optimizer == ADAM || optimizer == ADAMW) ? 2U : 1U;
+}
+
+// hyperparameters of one update, shared by every layer
+struct OptimizerStep
+{
+    OPTIMIZER optimizer = SGD;
+    double learningRate = 0.15;
+    double momentum = 0.5;     // SGD and NESTEROV
+    double beta1 = 0.9;        // ADAM decay of the gradient mean
+    double beta2 = 0.999;      // ADAM decay of the squared gradient mean, RMSPROP uses it too
+    double epsilon = 1e-8;     // keeps the RMS scaled steps finite
+    REGULARIZATION regularization = NO_REGULARIZATION;
+    double regularizationRate = 0.0;
+    double weightDecay = 0.0;  // decoupled from the gradient, every weight shrinks by learningRate * weightDecay
+    unsigned long step = 1UL;  // updates so far, this one included, for the ADAM bias correction
+
+    // the same step without penalty and decay, for the bias weights
+    inline OptimizerStep Unregularized() const
+    {
+        OptimizerStep step = *this;
+        step.regularization = NO_REGULARIZATION;
+        step.weightDecay = 0.0;
+        return step;
+    }
+};
+
+/* @brief
+ *   One fused pass of the update rule over n contiguous parameters
+ *   The gradient of params[i] is a * x[i], in the direction the parameters move (y - out), so
+ *   a weight matrix row takes the layer inputs and the neuron's delta, a summed batch gradient its mean scale
+ *   state0 (and state1 when OptimizerStates() is 2) hold the optimizer state of the same n parameters
+ *   Regularization and weight decay are applied in the same pass, parameters at zero (the row padding) stay zero
+ *   The implementation (AVX-512, AVX2 or scalar) is picked once at startup from the CPU features
+ */
+void OptimizerUpdate(const OptimizerStep &step, double *params, double *state0, double *state1, const double *x, double a, std::size_t n);
+void OptimizerUpdate(const OptimizerStep &step, float *params, float *state0, float *state1, const float *x, double a, std::size_t n);
+// mixed precision, the update accumulates in double master parameters and state,
+// shadow (the float working weights) gets the rounded result in the same pass
+void OptimizerUpdate(const OptimizerStep &step, double *params, double *state0, double *state1, const float *x, double a, std::size_t n,
+                     float *shadow);
+
+// instruction set of the selected update kernels, for logs and benchmarks
+const char *OptimizerKernelName();
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+#ifndef PRECISION_H
+#define PRECISION_H
+
+// scalar type the network trains and serves in
+enum PRECISION
+{
+    DOUBLE_PRECISION = 0,
+    SINGLE_PRECISION, // float weights, activations and dataset, twice the SIMD lanes and half the bandwidth
+    MIXED_PRECISION   // float activations and working weights, updates accumulate in double master weights
+};
+
+// call fn.template operator()<T>() with T the scalar type the activations are stored in
+// mixed precision runs its kernels in float, the master weights live inside the layers
+template <typename Fn>
+inline decltype(auto) DispatchPrecision(PRECISION precision, Fn &&fn)
+{
+    if (precision == DOUBLE_PRECISION)
+        return fn.template operator()<double>();
+    return fn.template operator()<float>();
+}
+
+#endif
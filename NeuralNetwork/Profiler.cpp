@@ -0,0 +1,231 @@
+#ifdef SNN_PROFILE
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include "AllocationCounter.hpp"
+#include "json.hpp"
+#include "Profiler.hpp"
+
+using json = nlohmann::json;
+
+static const char *PHASE_NAMES[NUM_PHASES] = {"FeedForward", "BackPropagate", "WeightUpdate", "DataAccess", "Logging"};
+constexpr std::size_t TRACE_CAPACITY = 1U << 18; // events per thread, allocated up front, later ones are only counted
+
+// one writer (the owning thread), relaxed load + store compiles to a plain add
+struct PhaseCounter
+{
+    std::atomic<std::uint64_t> cycles{0U};
+    std::atomic<std::uint64_t> calls{0U};
+    std::atomic<std::uint64_t> flops{0U};
+    std::atomic<std::uint64_t> bytes{0U};
+    std::atomic<std::uint64_t> samples{0U};
+};
+
+static inline void Add(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct TraceEvent
+{
+    std::uint64_t start = 0U;
+    std::uint64_t end = 0U;
+    PHASE phase = PHASE_FEED_FORWARD;
+};
+
+struct ThreadProfile
+{
+    unsigned int tid = 0U;
+    std::array<PhaseCounter, NUM_PHASES> counters;
+    std::vector<TraceEvent> events; // TRACE_CAPACITY reserved, only read once the training threads are idle
+    std::atomic<std::uint64_t> dropped{0U};
+};
+
+// plain copy of the counters of one phase
+struct PhaseTotals
+{
+    std::uint64_t cycles = 0U, calls = 0U, flops = 0U, bytes = 0U, samples = 0U;
+};
+
+struct EpochSummary
+{
+    unsigned int epoch = 0U;
+    std::uint64_t end = 0U; // tsc
+    std::array<PhaseTotals, NUM_PHASES> phases;
+};
+
+// profiles outlive their threads, the pool and validator threads are gone by the time the report is written
+static std::mutex s_mutex;
+static std::vector<std::unique_ptr<ThreadProfile>> s_threads;
+static std::vector<EpochSummary> s_epochs;
+static std::array<PhaseTotals, NUM_PHASES> s_reported{}; // totals at the last epoch boundary
+// tsc and wall clock at startup, their ratio at report time calibrates the tsc
+static const std::uint64_t s_startTsc = ReadTsc();
+static const auto s_startTime = std::chrono::steady_clock::now();
+
+// created on first use, RegisterThread() makes that happen before the thread's first training step
+static ThreadProfile &Local()
+{
+    thread_local ThreadProfile *profile = nullptr;
+    if (profile == nullptr)
+    {
+#ifdef SNN_COUNT_ALLOCATIONS
+        const std::uint64_t allocations = ThreadHeapAllocations();
+#endif
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_threads.push_back(std::make_unique<ThreadProfile>());
+        profile = s_threads.back().get();
+        profile->tid = s_threads.size();
+        profile->events.reserve(TRACE_CAPACITY);
+#ifdef SNN_COUNT_ALLOCATIONS
+        // profiler bookkeeping, not an allocation of the step a thread that never registered was timing
+        UncountThreadHeapAllocations(ThreadHeapAllocations() - allocations);
+#endif
+    }
+    return *profile;
+}
+
+// sum of every thread, caller holds s_mutex
+static std::array<PhaseTotals, NUM_PHASES> Totals()
+{
+    std::array<PhaseTotals, NUM_PHASES> totals{};
+    for (const auto &thread : s_threads)
+        for (auto p = 0; p < NUM_PHASES; ++p)
+        {
+            const PhaseCounter &counter = thread->counters[p];
+            totals[p].cycles += counter.cycles.load(std::memory_order_relaxed);
+            totals[p].calls += counter.calls.load(std::memory_order_relaxed);
+            totals[p].flops += counter.flops.load(std::memory_order_relaxed);
+            totals[p].bytes += counter.bytes.load(std::memory_order_relaxed);
+            totals[p].samples += counter.samples.load(std::memory_order_relaxed);
+        }
+    return totals;
+}
+
+void Profiler::Record(PHASE phase, std::uint64_t start, std::uint64_t end)
+{
+    ThreadProfile &profile = Local();
+    Add(profile.counters[phase].cycles, end - start);
+    Add(profile.counters[phase].calls, 1U);
+    // never past the reserve, a scope must not allocate
+    if (profile.events.size() < profile.events.capacity())
+        profile.events.push_back({start, end, phase});
+    else
+        Add(profile.dropped, 1U);
+}
+
+void Profiler::RegisterThread()
+{
+    Local();
+}
+
+void Profiler::Count(PHASE phase, std::uint64_t flops, std::uint64_t bytes, std::uint64_t samples)
+{
+    PhaseCounter &counter = Local().counters[phase];
+    Add(counter.flops, flops);
+    Add(counter.bytes, bytes);
+    Add(counter.samples, samples);
+}
+
+void Profiler::EndEpoch(unsigned int epoch)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const std::array<PhaseTotals, NUM_PHASES> totals = Totals();
+    EpochSummary summary{};
+    summary.epoch = epoch;
+    summary.end = ReadTsc();
+    for (auto p = 0; p < NUM_PHASES; ++p)
+        summary.phases[p] = {totals[p].cycles - s_reported[p].cycles, totals[p].calls - s_reported[p].calls, totals[p].flops - s_reported[p].flops,
+                             totals[p].bytes - s_reported[p].bytes, totals[p].samples - s_reported[p].samples};
+    s_reported = totals;
+    s_epochs.push_back(summary);
+}
+
+void Profiler::Report(const std::string &tracePath)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_startTime).count();
+    const double ticksPerSecond = (seconds > 0.0) ? (ReadTsc() - s_startTsc) / seconds : 1e9;
+    auto ms = [&](std::uint64_t ticks)
+    { return ticks * 1e3 / ticksPerSecond; };
+
+    // per-epoch summary, every thread added up
+    std::printf("Profile (all threads, %.2f GHz tick) per epoch in ms\n", ticksPerSecond * 1e-9);
+    std::printf("%8s", "Epoch");
+    for (auto p = 0; p < NUM_PHASES; ++p)
+        std::printf(" %14s", PHASE_NAMES[p]);
+    std::printf(" %10s\n", "Samples");
+    for (const EpochSummary &summary : s_epochs)
+    {
+        std::printf("%8u", summary.epoch);
+        for (auto p = 0; p < NUM_PHASES; ++p)
+            std::printf(" %14.3f", ms(summary.phases[p].cycles));
+        std::printf(" %10llu\n", static_cast<unsigned long long>(summary.phases[PHASE_FEED_FORWARD].samples));
+    }
+    const std::array<PhaseTotals, NUM_PHASES> totals = Totals();
+    std::uint64_t all = 0U;
+    for (const PhaseTotals &phase : totals)
+        all += phase.cycles;
+    std::printf("%-14s %12s %7s %12s %10s %10s %12s\n", "Phase", "ms", "%", "Calls", "GFLOP/s", "GB/s", "Samples");
+    for (auto p = 0; p < NUM_PHASES; ++p)
+    {
+        const double s = ms(totals[p].cycles) * 1e-3;
+        std::printf("%-14s %12.3f %6.1f%% %12llu %10.3f %10.3f %12llu\n", PHASE_NAMES[p], s * 1e3, all ? 100.0 * totals[p].cycles / all : 0.0,
+                    static_cast<unsigned long long>(totals[p].calls), s > 0.0 ? totals[p].flops / s * 1e-9 : 0.0,
+                    s > 0.0 ? totals[p].bytes / s * 1e-9 : 0.0, static_cast<unsigned long long>(totals[p].samples));
+    }
+
+    if (!tracePath.empty())
+    {
+        // Chrome trace-event format, complete events in microseconds since startup
+        auto us = [&](std::uint64_t tsc)
+        { return (tsc - s_startTsc) * 1e6 / ticksPerSecond; };
+        json events = json::array();
+        std::uint64_t dropped = 0U;
+        for (const auto &thread : s_threads)
+        {
+            events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", thread->tid}, {"args", {{"name", "thread " + std::to_string(thread->tid)}}}});
+            for (const TraceEvent &event : thread->events)
+                events.push_back({{"name", PHASE_NAMES[event.phase]}, {"cat", "train"}, {"ph", "X"}, {"pid", 1}, {"tid", thread->tid},
+                                  {"ts", us(event.start)}, {"dur", (event.end - event.start) * 1e6 / ticksPerSecond}});
+            dropped += thread->dropped.load(std::memory_order_relaxed);
+        }
+        // per-epoch phase times as counter tracks
+        for (const EpochSummary &summary : s_epochs)
+        {
+            json args;
+            for (auto p = 0; p < NUM_PHASES; ++p)
+                args[PHASE_NAMES[p]] = ms(summary.phases[p].cycles);
+            events.push_back({{"name", "epoch ms"}, {"ph", "C"}, {"pid", 1}, {"ts", us(summary.end)}, {"args", args}});
+        }
+        std::ofstream f(tracePath, std::ios::trunc);
+        if (!f.is_open())
+            std::cerr << "Failed to open file! Trace Path : " << tracePath << std::endl;
+        else
+        {
+            f << json{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+            f.close(); // remember to close file to prevent leak
+            std::cout << "Trace written to : " << tracePath;
+            if (dropped != 0)
+                std::cout << " (" << dropped << " Events dropped)";
+            std::cout << std::endl;
+        }
+    }
+
+    // start over for the next run
+    for (auto &thread : s_threads)
+    {
+        for (PhaseCounter &counter : thread->counters)
+            counter.cycles = counter.calls = counter.flops = counter.bytes = counter.samples = 0U;
+        thread->events.clear();
+        thread->dropped = 0U;
+    }
+    s_epochs.clear();
+    s_reported = {};
+}
+
+#endif
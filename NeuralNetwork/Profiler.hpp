@@ -0,0 +1,90 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// what a timed scope is accounted to
+enum PHASE
+{
+    PHASE_FEED_FORWARD = 0,
+    PHASE_BACK_PROPAGATE, // output and hidden gradients, batch weight gradient sums
+    PHASE_WEIGHT_UPDATE,
+    PHASE_DATA_ACCESS,    // reading the dataset, latching rows into the input layer
+    PHASE_LOGGING,        // handing progress to the reporter
+    NUM_PHASES
+};
+
+// time stamp counter, nanoseconds where there is none, converted to seconds only when reporting
+inline std::uint64_t ReadTsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#ifdef SNN_PROFILE
+
+/* @brief
+ *   Hot path instrumentation, compiled in with -DSNN_PROFILE (cmake -DSNN_PROFILE=ON)
+ *   Every thread accumulates cycles, calls and nominal FLOPs/bytes/samples per phase into its own
+ *   counters and its scopes into its own trace buffer, nothing is shared while training runs
+ *   The buffer has a fixed capacity allocated by RegisterThread(), which every training thread calls
+ *   before its first step, so recording never touches the heap, scopes past the capacity are only counted
+ *   EndEpoch() snapshots the totals of all threads, Report() prints the per-epoch summary and
+ *   writes the scopes as a Chrome trace (chrome://tracing, Perfetto) then starts over
+ *   Without SNN_PROFILE the macros below expand to nothing, arguments included
+ */
+class Profiler
+{
+public:
+    static void RegisterThread(); // allocate the calling thread's counters and trace buffer now
+    static void Record(PHASE phase, std::uint64_t start, std::uint64_t end);
+    static void Count(PHASE phase, std::uint64_t flops, std::uint64_t bytes, std::uint64_t samples);
+    static void EndEpoch(unsigned int epoch);
+    static void Report(const std::string &tracePath); // empty path prints the summary only
+};
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(PHASE phase) : m_phase(phase), m_start(ReadTsc()) {}
+    ~ScopedTimer() { Profiler::Record(m_phase, m_start, ReadTsc()); }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    PHASE m_phase;
+    std::uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_THREAD() Profiler::RegisterThread()
+#define PROFILE_SCOPE(phase) ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#define PROFILE_COUNT(phase, flops, bytes, samples) Profiler::Count(phase, flops, bytes, samples)
+#define PROFILE_EPOCH(epoch) Profiler::EndEpoch(epoch)
+#define PROFILE_REPORT(tracePath) Profiler::Report(tracePath)
+
+#else
+
+#define PROFILE_THREAD() ((void)0)
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_COUNT(phase, flops, bytes, samples) ((void)0)
+#define PROFILE_EPOCH(epoch) ((void)0)
+#define PROFILE_REPORT(tracePath) ((void)0)
+
+#endif
+
+#endif
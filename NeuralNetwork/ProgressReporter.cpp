@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include "ProgressReporter.hpp"
+
+ProgressReporter::ProgressReporter(VERBOSITY verbosity, unsigned long reportInterval)
+    : m_verbosity(verbosity), m_interval(reportInterval ? reportInterval : 1UL), m_nextReport(m_interval)
+{
+    if (m_verbosity != QUIET)
+        m_thread = std::thread(&ProgressReporter::LoggerLoop, this);
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    Stop();
+}
+
+void ProgressReporter::Stop()
+{
+    m_stop.store(true, std::memory_order_release);
+    if (m_thread.joinable())
+        m_thread.join();
+    unsigned long dropped = m_dropped.exchange(0);
+    if (dropped)
+        std::cout << "(" << dropped << " progress reports dropped)" << std::endl;
+}
+
+void ProgressReporter::Push(const ProgressEvent &event)
+{
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == CAPACITY)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_ring[head & (CAPACITY - 1)] = event;
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+void ProgressReporter::LoggerLoop()
+{
+    while (true)
+    {
+        // read the stop flag first so nothing pushed before Stop() is missed
+        const bool stopping = m_stop.load(std::memory_order_acquire);
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        const std::size_t head = m_head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail)
+            Print(m_ring[tail & (CAPACITY - 1)]);
+        m_tail.store(tail, std::memory_order_release);
+        std::cout.flush(); // one flush per drained batch of events
+        if (stopping)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+void ProgressReporter::Print(const ProgressEvent &event) const
+{
+    // formatted into a local buffer, the precision of the shared std::cout is never touched
+    // and the line is handed over in one piece
+    char line[128];
+    int length = 0;
+    if (event.kind == ProgressEvent::EPOCH)
+        length = std::snprintf(line, sizeof(line), "Training Pass: %u\tSamples: %lu\tAvg error: %.4g\n", event.epoch, event.samples, event.error);
+    else if (event.kind == ProgressEvent::VALIDATION)
+        length = std::snprintf(line, sizeof(line), "Validation Pass: %u\tSamples: %lu\tAccuracy: %.4g\n", event.epoch, event.samples, event.error);
+    else
+        length = std::snprintf(line, sizeof(line), "  Pass %u Sample %lu\tAvg error: %.4g\n", event.epoch, event.samples, event.error);
+    if (length > 0)
+        std::cout.write(line, std::min<std::size_t>(length, sizeof(line) - 1));
+}
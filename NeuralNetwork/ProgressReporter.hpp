@@ -0,0 +1,88 @@
+#pragma once
+#ifndef PROGRESSREPORTER_H
+#define PROGRESSREPORTER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include "AlignedBuffer.hpp"
+
+// how much the training loop reports
+enum VERBOSITY
+{
+    QUIET = 0, // nothing but the start/end banner
+    PER_EPOCH, // one line per epoch
+    PER_SAMPLES // one line every reportInterval samples, plus the epoch lines
+};
+
+struct ProgressEvent
+{
+    enum Kind : unsigned char
+    {
+        SAMPLES = 0,
+        EPOCH,
+        VALIDATION // error holds the validation accuracy
+    };
+    Kind kind = EPOCH;
+    unsigned int epoch = 0U;
+    unsigned long samples = 0UL; // samples seen in this epoch
+    double error = 0.0;          // recent average error
+};
+
+/* @brief
+ *   Prints training progress from a background thread
+ *   The training thread only pushes small events into a lock-free single producer,
+ *   single consumer ring buffer; formatting and console I/O happen on the logging thread.
+ *   When the ring is full the event is dropped instead of making the training thread wait.
+ */
+class ProgressReporter
+{
+public:
+    explicit ProgressReporter(VERBOSITY verbosity, unsigned long reportInterval = 100UL);
+    ~ProgressReporter();
+    ProgressReporter(const ProgressReporter &) = delete;
+    ProgressReporter &operator=(const ProgressReporter &) = delete;
+
+    // called by the training thread, never blocks
+    inline void SamplesDone(unsigned int epoch, unsigned long samples, double error)
+    {
+        if (m_verbosity < PER_SAMPLES || samples < m_nextReport)
+            return;
+        m_nextReport = (samples / m_interval + 1) * m_interval;
+        Push({ProgressEvent::SAMPLES, epoch, samples, error});
+    }
+    inline void EpochDone(unsigned int epoch, unsigned long samples, double error)
+    {
+        m_nextReport = m_interval; // sample counter restarts every epoch
+        if (m_verbosity >= PER_EPOCH)
+            Push({ProgressEvent::EPOCH, epoch, samples, error});
+    }
+    inline void Validated(unsigned int epoch, unsigned long samples, double accuracy)
+    {
+        if (m_verbosity >= PER_EPOCH)
+            Push({ProgressEvent::VALIDATION, epoch, samples, accuracy});
+    }
+
+    // drain whatever is left and join the logging thread
+    void Stop();
+
+private:
+    static constexpr std::size_t CAPACITY = 1024U; // power of two
+    void Push(const ProgressEvent &event);
+    void LoggerLoop();
+    void Print(const ProgressEvent &event) const;
+
+    VERBOSITY m_verbosity = PER_EPOCH;
+    unsigned long m_interval = 100UL;
+    unsigned long m_nextReport = 100UL; // producer side only
+
+    std::array<ProgressEvent, CAPACITY> m_ring{};
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_head{0}; // next slot written by the producer
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_tail{0}; // next slot read by the consumer
+    alignas(CACHE_LINE) std::atomic<bool> m_stop{false};
+    std::atomic<unsigned long> m_dropped{0};
+    std::thread m_thread;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "KernelDispatch.hpp"
+#include "QuantizedKernels.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NN_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    using DotFn = std::int32_t (*)(const std::uint8_t *a, const std::int8_t *b, std::size_t n);
+
+    struct KernelTable
+    {
+        DotFn dot;
+        const char *name;
+    };
+
+    std::int32_t DotScalar(const std::uint8_t *a, const std::int8_t *b, std::size_t n)
+    {
+        std::int32_t sum = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            sum += static_cast<std::int32_t>(a[i]) * b[i];
+        return sum;
+    }
+
+#ifdef NN_X86_DISPATCH
+    // u8 * s8 pairs summed into s16 (maddubs), then pairs of s16 summed into s32 (madd with ones)
+    __attribute__((target("avx2"))) std::int32_t DotAvx2(const std::uint8_t *a, const std::int8_t *b, std::size_t n)
+    {
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i acc = _mm256_setzero_si256();
+        for (std::size_t i = 0; i < n; i += 32)
+        {
+            __m256i pairs = _mm256_maddubs_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                                 _mm256_load_si256(reinterpret_cast<const __m256i *>(b + i)));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, ones));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(s);
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) std::int32_t DotAvx512(const std::uint8_t *a, const std::int8_t *b, std::size_t n)
+    {
+        const __m512i ones = _mm512_set1_epi16(1);
+        __m512i acc = _mm512_setzero_si512();
+        for (std::size_t i = 0; i < n; i += 64)
+        {
+            __m512i pairs = _mm512_maddubs_epi16(_mm512_load_si512(a + i), _mm512_load_si512(b + i));
+            acc = _mm512_add_epi32(acc, _mm512_madd_epi16(pairs, ones));
+        }
+        return _mm512_reduce_add_epi32(acc);
+    }
+
+    // vpdpbusd does the u8 * s8 products and the 4-way sum into s32 in one instruction
+    __attribute__((target("avx512f,avx512vnni"))) std::int32_t DotVnni(const std::uint8_t *a, const std::int8_t *b, std::size_t n)
+    {
+        __m512i acc = _mm512_setzero_si512();
+        for (std::size_t i = 0; i < n; i += 64)
+            acc = _mm512_dpbusd_epi32(acc, _mm512_load_si512(a + i), _mm512_load_si512(b + i));
+        return _mm512_reduce_add_epi32(acc);
+    }
+#endif
+
+    KernelTable SelectKernels()
+    {
+#ifdef NN_X86_DISPATCH
+        __builtin_cpu_init();
+        if (IsaAllowed(ISA_AVX512) && __builtin_cpu_supports("avx512vnni"))
+            return {DotVnni, "avx512vnni"};
+        if (IsaAllowed(ISA_AVX512) && __builtin_cpu_supports("avx512bw"))
+            return {DotAvx512, "avx512bw"};
+        if (IsaAllowed(ISA_AVX2) && __builtin_cpu_supports("avx2"))
+            return {DotAvx2, "avx2"};
+#endif
+        return {DotScalar, "scalar"};
+    }
+
+    // resolved once, on first use
+    const KernelTable &Kernels()
+    {
+        static const KernelTable table = SelectKernels();
+        return table;
+    }
+}
+
+void GemmU8S8(std::size_t M, std::size_t N, std::size_t K,
+              const std::uint8_t *A, std::size_t lda, const std::int8_t *B, std::size_t ldb,
+              std::int32_t *C, std::size_t ldc)
+{
+    // every weight row is reused across the whole batch while it is in L1
+    const DotFn dot = Kernels().dot;
+    for (std::size_t j = 0; j < N; ++j)
+    {
+        const std::int8_t *b = B + j * ldb;
+        for (std::size_t i = 0; i < M; ++i)
+            C[i * ldc + j] = dot(A + i * lda, b, K);
+    }
+}
+
+const char *QuantizedKernelName() { return Kernels().name; }
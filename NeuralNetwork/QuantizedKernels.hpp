@@ -0,0 +1,26 @@
+#pragma once
+#ifndef QUANTIZEDKERNELS_H
+#define QUANTIZEDKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// activations are quantized to 7 bits, so two u8 * s8 products never saturate the
+// 16 bit lanes of maddubs and every implementation gives bit identical sums
+constexpr std::int32_t QUANT_ACTIVATION_MAX = 127;
+constexpr std::int32_t QUANT_WEIGHT_MAX = 127;
+
+/* @brief
+ *   Integer matrix multiply for the quantized forward pass, C = A * B^T
+ *   A is M x K unsigned activations, B is N x K signed weights, C is M x N int32 sums
+ *   K has to be a multiple of 64 (one cache line of bytes) and the padding has to be zero
+ *   The implementation (AVX-512 VNNI, AVX-512 BW, AVX2 maddubs or scalar) is picked once at startup
+ */
+void GemmU8S8(std::size_t M, std::size_t N, std::size_t K,
+              const std::uint8_t *A, std::size_t lda, const std::int8_t *B, std::size_t ldb,
+              std::int32_t *C, std::size_t ldc);
+
+// name of the selected implementation, "avx512vnni", "avx512bw", "avx2" or "scalar"
+const char *QuantizedKernelName();
+
+#endif
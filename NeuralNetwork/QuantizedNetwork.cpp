@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include "QuantizedNetwork.hpp"
+#include "ActivationKernels.hpp"
+#include "ModelFormat.hpp"
+#include "QuantizedKernels.hpp"
+
+// scale and zero point that map [lo, hi] onto [0, QUANT_ACTIVATION_MAX], zero always exactly representable
+static void InputQuantization(double lo, double hi, float &scale, std::int32_t &zero)
+{
+    lo = std::min(lo, 0.0);
+    hi = std::max(hi, 0.0);
+    const double spread = hi - lo;
+    scale = (spread > 0.0) ? static_cast<float>(spread / QUANT_ACTIVATION_MAX) : 1.0f;
+    zero = std::clamp<std::int32_t>(static_cast<std::int32_t>(std::lrint(-lo / scale)), 0, QUANT_ACTIVATION_MAX);
+}
+
+// rows of cols floats (stride apart) into the quantized input rows of layer
+static void QuantizeRows(const float *values, std::size_t cols, std::size_t stride, unsigned int rows,
+                         const QuantizedLayer &layer, std::uint8_t *out)
+{
+    const float inv = 1.0f / layer.inScale;
+    for (auto r = 0; r < rows; ++r)
+    {
+        const float *x = values + r * stride;
+        std::uint8_t *q = out + r * layer.stride;
+        for (std::size_t c = 0; c < cols; ++c)
+            q[c] = static_cast<std::uint8_t>(std::clamp<std::int32_t>(static_cast<std::int32_t>(std::lrint(x[c] * inv)) + layer.inZero,
+                                                                      0, QUANT_ACTIVATION_MAX));
+    }
+}
+
+template <typename T>
+void QuantizedNetwork::Build(const std::vector<Layer<T>> &network, const std::vector<std::pair<double, double>> &ranges, const Normalizer &normalizer)
+{
+    m_model.Close();
+    m_layers.clear();
+    m_workspaces.clear();
+
+    // lay out the blocks first, exactly like the file
+    std::vector<QuantLayerRecord> records(network.size());
+    std::size_t offset = AlignModelOffset(sizeof(QuantHeader) + records.size() * sizeof(QuantLayerRecord));
+    for (auto index_layer = 0; index_layer < network.size(); ++index_layer)
+    {
+        const Layer<T> &layer = network[index_layer];
+        QuantLayerRecord &record = records[index_layer];
+        record = QuantLayerRecord{}; // every field zero, the offsets of the input layer stay that way
+        record.size = layer.size();
+        record.numInputs = layer.NumInputs();
+        record.activation = static_cast<std::uint32_t>(layer.Function());
+        if (index_layer == 0)
+            continue; // the input layer has no weights
+        InputQuantization(ranges[index_layer - 1].first, ranges[index_layer - 1].second, record.inScale, record.inZero);
+        record.stride = PaddedStride<std::int8_t>(layer.NumInputs());
+        record.weightOffset = offset;
+        offset = AlignModelOffset(offset + layer.size() * record.stride);
+        record.scaleOffset = offset;
+        offset = AlignModelOffset(offset + layer.size() * sizeof(float));
+        record.sumOffset = offset;
+        offset = AlignModelOffset(offset + layer.size() * sizeof(std::int32_t));
+        record.biasOffset = offset;
+        offset = AlignModelOffset(offset + layer.size() * sizeof(float));
+    }
+    const std::size_t normOffset = normalizer.empty() ? 0U : offset;
+    if (!normalizer.empty())
+        offset = AlignModelOffset(offset + 2 * normalizer.size() * sizeof(double));
+
+    m_storage.Resize(offset); // zeroed, so every padding byte is zero
+    char *data = m_storage.data();
+    QuantHeader header{};
+    std::copy(std::begin(QUANT_MAGIC), std::end(QUANT_MAGIC), header.magic);
+    header.version = QUANT_VERSION;
+    header.numLayers = network.size();
+    header.normInputs = normalizer.size();
+    header.bias = network.front().Bias();
+    header.fileBytes = offset;
+    header.normOffset = normOffset;
+    std::copy(records.begin(), records.end(), reinterpret_cast<QuantLayerRecord *>(data + sizeof(QuantHeader)));
+
+    // symmetric per row weights, the bias weight stays in float
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
+    {
+        const Layer<T> &layer = network[index_layer];
+        const QuantLayerRecord &record = records[index_layer];
+        std::int8_t *weights = reinterpret_cast<std::int8_t *>(data + record.weightOffset);
+        float *scales = reinterpret_cast<float *>(data + record.scaleOffset);
+        std::int32_t *sums = reinterpret_cast<std::int32_t *>(data + record.sumOffset);
+        float *biasWeights = reinterpret_cast<float *>(data + record.biasOffset);
+        for (auto n = 0; n < layer.size(); ++n)
+        {
+            const T *w = layer.Weights(n);
+            double maxAbs = 0.0;
+            for (auto c = 0; c < layer.NumInputs(); ++c)
+                maxAbs = std::max(maxAbs, std::abs(static_cast<double>(w[c])));
+            const double scale = (maxAbs > 0.0) ? maxAbs / QUANT_WEIGHT_MAX : 1.0;
+            std::int8_t *q = weights + n * record.stride;
+            std::int32_t sum = 0;
+            for (auto c = 0; c < layer.NumInputs(); ++c)
+            {
+                q[c] = static_cast<std::int8_t>(std::clamp<long>(std::lrint(w[c] / scale), -QUANT_WEIGHT_MAX, QUANT_WEIGHT_MAX));
+                sum += q[c];
+            }
+            scales[n] = static_cast<float>(scale);
+            sums[n] = sum;
+            biasWeights[n] = static_cast<float>(layer.BiasWeights()[n]);
+        }
+    }
+    if (!normalizer.empty())
+    {
+        double *block = reinterpret_cast<double *>(data + normOffset);
+        std::copy(normalizer.Offsets().begin(), normalizer.Offsets().end(), block);
+        std::copy(normalizer.Scales().begin(), normalizer.Scales().end(), block + normalizer.size());
+    }
+    header.checksum = ModelChecksum(data + sizeof(QuantHeader), offset - sizeof(QuantHeader));
+    std::copy(reinterpret_cast<const char *>(&header), reinterpret_cast<const char *>(&header) + sizeof(header), data);
+    Attach(data);
+}
+
+bool QuantizedNetwork::Save(const std::string &path) const
+{
+    if (m_layers.empty())
+        return false;
+    // through a temporary file, the model may be mapped from path itself
+    const std::string tempPath = path + ".tmp";
+    std::ofstream f(tempPath, std::ios::binary | std::ios::trunc);
+    if (!f.is_open())
+        return false;
+    const char *data = m_model.IsOpen() ? m_model.data() : m_storage.data();
+    f.write(data, m_bytes);
+    f.close(); // remember to close file to prevent leak
+    if (!f.good() || std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool QuantizedNetwork::Load(const std::string &path)
+{
+    m_layers.clear();
+    m_workspaces.clear();
+    m_storage.Resize(0);
+    if (!m_model.Open(path))
+        return false;
+    const char *data = m_model.data();
+    const std::size_t size = m_model.size();
+    const QuantHeader *header = reinterpret_cast<const QuantHeader *>(data);
+    if (size < sizeof(QuantHeader) || !std::equal(std::begin(QUANT_MAGIC), std::end(QUANT_MAGIC), header->magic) ||
+        header->version < QUANT_MIN_VERSION || header->version > QUANT_VERSION || header->fileBytes != size || header->numLayers < 2 ||
+        sizeof(QuantHeader) + header->numLayers * sizeof(QuantLayerRecord) > size ||
+        ((header->version >= QUANT_XXH64_VERSION) ? ModelChecksum(data + sizeof(QuantHeader), size - sizeof(QuantHeader))
+                                                  : ModelChecksumFnv(data + sizeof(QuantHeader), size - sizeof(QuantHeader))) != header->checksum)
+    {
+        m_model.Close();
+        return false;
+    }
+    // every block has to be aligned, inside the file and consistent with the previous layer
+    const QuantLayerRecord *records = reinterpret_cast<const QuantLayerRecord *>(data + sizeof(QuantHeader));
+    auto isBlock = [&](std::uint64_t offset, std::uint64_t bytes)
+    { return offset % MODEL_ALIGNMENT == 0 && offset != 0 && offset + bytes <= size; };
+    bool isValid = header->normInputs == 0 || (header->normInputs == records[0].size && isBlock(header->normOffset, 2 * header->normInputs * sizeof(double)));
+    for (auto index_layer = 1; isValid && index_layer < header->numLayers; ++index_layer)
+    {
+        const QuantLayerRecord &record = records[index_layer];
+        isValid = record.numInputs == records[index_layer - 1].size && record.activation <= SOFTMAX && record.inScale > 0.0f &&
+                  record.stride % MODEL_ALIGNMENT == 0 && record.stride >= record.numInputs &&
+                  isBlock(record.weightOffset, record.size * record.stride) && isBlock(record.scaleOffset, record.size * sizeof(float)) &&
+                  isBlock(record.sumOffset, record.size * sizeof(std::int32_t)) && isBlock(record.biasOffset, record.size * sizeof(float));
+    }
+    if (!isValid)
+    {
+        m_model.Close();
+        return false;
+    }
+    Attach(data);
+    return true;
+}
+
+void QuantizedNetwork::Attach(const char *data)
+{
+    const QuantHeader *header = reinterpret_cast<const QuantHeader *>(data);
+    const QuantLayerRecord *records = reinterpret_cast<const QuantLayerRecord *>(data + sizeof(QuantHeader));
+    m_bytes = header->fileBytes;
+    m_bias = header->bias;
+    m_layers.assign(header->numLayers, QuantizedLayer{});
+    for (auto index_layer = 0; index_layer < header->numLayers; ++index_layer)
+    {
+        const QuantLayerRecord &record = records[index_layer];
+        QuantizedLayer &layer = m_layers[index_layer];
+        layer.size = record.size;
+        layer.numInputs = record.numInputs;
+        layer.function = static_cast<FUNCTION>(record.activation);
+        if (index_layer == 0)
+            continue;
+        layer.stride = record.stride;
+        layer.inScale = record.inScale;
+        layer.inZero = record.inZero;
+        layer.weights = reinterpret_cast<const std::int8_t *>(data + record.weightOffset);
+        layer.weightScales = reinterpret_cast<const float *>(data + record.scaleOffset);
+        layer.weightSums = reinterpret_cast<const std::int32_t *>(data + record.sumOffset);
+        layer.biasWeights = reinterpret_cast<const float *>(data + record.biasOffset);
+    }
+    m_normalizer.Clear();
+    if (header->normInputs != 0)
+    {
+        const double *block = reinterpret_cast<const double *>(data + header->normOffset);
+        m_normalizer.Load(block, block + header->normInputs, header->normInputs);
+    }
+}
+
+bool QuantizedNetwork::Predict(std::span<const float> inputs, std::size_t batch, std::span<float> outputs) const
+{
+    if (m_layers.empty())
+        return false;
+    const unsigned int inSize = m_layers.front().size;
+    const unsigned int outSize = m_layers.back().size;
+    if (inputs.size() < batch * inSize || outputs.size() < batch * outSize)
+        return false;
+
+    std::unique_ptr<Workspace> ws = AcquireWorkspace();
+    const std::size_t last = m_layers.size() - 1;
+    for (std::size_t first = 0; first < batch; first += QUANT_BATCH)
+    {
+        const unsigned int rows = std::min<std::size_t>(QUANT_BATCH, batch - first);
+        // normalize in float, then quantize into the input rows of the first layer
+        float *values = ws->values.data();
+        std::copy(inputs.data() + first * inSize, inputs.data() + (first + rows) * inSize, values);
+        m_normalizer.Transform(values, inSize, rows);
+        QuantizeRows(values, inSize, inSize, rows, m_layers[1], ws->inputs[1].data());
+        for (auto index_layer = 1; index_layer <= last; ++index_layer)
+        {
+            const QuantizedLayer &layer = m_layers[index_layer];
+            GemmU8S8(rows, layer.size, layer.stride, ws->inputs[index_layer].data(), layer.stride,
+                     layer.weights, layer.stride, ws->sums.data(), layer.size);
+            // back to float: z = inScale * weightScale * (sum - inZero * weightSum) + biasWeight * bias
+            for (auto r = 0; r < rows; ++r)
+            {
+                const std::int32_t *sum = ws->sums.data() + r * layer.size;
+                float *z = values + r * layer.size;
+                for (auto n = 0; n < layer.size; ++n)
+                    z[n] = layer.inScale * layer.weightScales[n] * static_cast<float>(sum[n] - layer.inZero * layer.weightSums[n]) +
+                           layer.biasWeights[n] * static_cast<float>(m_bias);
+                ActivateBatch<float>({z, layer.size}, layer.function);
+            }
+            if (index_layer == last)
+                std::copy(values, values + rows * outSize, outputs.data() + first * outSize);
+            else
+                QuantizeRows(values, layer.size, layer.size, rows, m_layers[index_layer + 1], ws->inputs[index_layer + 1].data());
+        }
+    }
+    ReleaseWorkspace(std::move(ws));
+    return true;
+}
+
+std::unique_ptr<QuantizedNetwork::Workspace> QuantizedNetwork::AcquireWorkspace() const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_workspaces.empty())
+        {
+            std::unique_ptr<Workspace> ws = std::move(m_workspaces.back());
+            m_workspaces.pop_back();
+            return ws;
+        }
+    }
+    // only when more calls run at once than ever before, later calls reuse it
+    std::unique_ptr<Workspace> ws = std::make_unique<Workspace>();
+    std::size_t width = 0U;
+    ws->inputs.resize(m_layers.size());
+    for (auto index_layer = 0; index_layer < m_layers.size(); ++index_layer)
+    {
+        width = std::max<std::size_t>(width, m_layers[index_layer].size);
+        if (index_layer > 0)
+            ws->inputs[index_layer].Resize(QUANT_BATCH * m_layers[index_layer].stride); // padding stays zero
+    }
+    ws->sums.Resize(QUANT_BATCH * width);
+    ws->values.Resize(QUANT_BATCH * width);
+    return ws;
+}
+
+void QuantizedNetwork::ReleaseWorkspace(std::unique_ptr<Workspace> ws) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_workspaces.push_back(std::move(ws));
+}
+
+template void QuantizedNetwork::Build<float>(const std::vector<Layer<float>> &, const std::vector<std::pair<double, double>> &, const Normalizer &);
+template void QuantizedNetwork::Build<double>(const std::vector<Layer<double>> &, const std::vector<std::pair<double, double>> &, const Normalizer &);
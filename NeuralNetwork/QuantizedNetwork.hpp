@@ -0,0 +1,86 @@
+#pragma once
+#ifndef QUANTIZEDNETWORK_H
+#define QUANTIZEDNETWORK_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AlignedBuffer.hpp"
+#include "Layer.hpp"
+#include "MappedFile.hpp"
+#include "Normalizer.hpp"
+
+#define QUANT_BATCH 64U // rows per forward pass in QuantizedNetwork::Predict
+
+// one layer of a quantized model, points into the model block
+struct QuantizedLayer
+{
+    unsigned int size = 0U;      // number of neurons, bias excluded
+    unsigned int numInputs = 0U; // number of neurons in the previous layer, bias excluded
+    std::size_t stride = 0U;     // padded input count, bytes per weight row and per input row
+    FUNCTION function = SIGMOID;
+    float inScale = 1.0f;        // input x is stored as round(x / inScale) + inZero
+    std::int32_t inZero = 0;
+    const std::int8_t *weights = nullptr;
+    const float *weightScales = nullptr;    // one per row, w = weights * weightScale
+    const std::int32_t *weightSums = nullptr; // one per row, folds the input zero point out of the product
+    const float *biasWeights = nullptr;     // one per row, kept in float
+};
+
+/* @brief
+ *   int8 post-training quantization of a trained network, forward pass only
+ *   Build() quantizes the weights row by row (symmetric, int8) and the input of every layer
+ *   (asymmetric, 7 bit) with the scale/zero point of the range it took on a calibration sample
+ *   The whole model is one block laid out exactly like the quantized model file (see ModelFormat.hpp),
+ *   Save() writes the block as is and Load() memory maps a file and runs straight from it
+ */
+class QuantizedNetwork
+{
+public:
+    QuantizedNetwork() = default;
+    QuantizedNetwork(const QuantizedNetwork &) = delete;
+    QuantizedNetwork &operator=(const QuantizedNetwork &) = delete;
+
+    // ranges[l] is the [min, max] the inputs of layer l + 1 took on the calibration sample
+    // normalizer is the input scaling the network was trained with, Predict applies it
+    template <typename T>
+    void Build(const std::vector<Layer<T>> &network, const std::vector<std::pair<double, double>> &ranges, const Normalizer &normalizer);
+    bool Save(const std::string &path) const;
+    bool Load(const std::string &path); // false when the file is missing or not a valid quantized model
+    // same contract as NeuralNetwork::Predict, raw inputs are normalized with the saved scaling
+    // read-only and safe to call from many threads at once
+    bool Predict(std::span<const float> inputs, std::size_t batch, std::span<float> outputs) const;
+
+    inline bool empty() const { return m_layers.empty(); }
+    inline std::size_t Bytes() const { return m_bytes; } // size of the model block
+    inline const std::vector<QuantizedLayer> &Layers() const { return m_layers; }
+
+private:
+    // per call scratch, pooled so a warmed up Predict does not allocate
+    struct Workspace
+    {
+        std::vector<AlignedBuffer<std::uint8_t>> inputs; // quantized input rows of every layer
+        AlignedBuffer<std::int32_t> sums;                // integer products of the current layer
+        AlignedBuffer<float> values;                     // float outputs of the current layer
+    };
+
+    // point m_layers and m_normalizer into a validated model block
+    void Attach(const char *data);
+    std::unique_ptr<Workspace> AcquireWorkspace() const;
+    void ReleaseWorkspace(std::unique_ptr<Workspace> ws) const;
+
+    AlignedBuffer<char> m_storage; // model block built by Build()
+    MappedFile m_model;            // model block loaded by Load()
+    std::size_t m_bytes = 0U;
+    double m_bias = 0.0;
+    std::vector<QuantizedLayer> m_layers;
+    Normalizer m_normalizer;
+    mutable std::mutex m_mutex;
+    mutable std::vector<std::unique_ptr<Workspace>> m_workspaces; // idle inference workspaces
+};
+
+#endif
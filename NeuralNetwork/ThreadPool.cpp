@@ -0,0 +1,66 @@
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned int numThreads) : m_size(numThreads ? numThreads : 1U), m_barrier(numThreads ? numThreads : 1U)
+{
+    PROFILE_THREAD(); // the caller is worker 0
+    for (auto index = 1U; index < m_size; ++index)
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this, index);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::RunTask(void *task, TaskFn fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = task;
+        m_taskFn = fn;
+        m_pending = m_size - 1;
+        ++m_generation;
+    }
+    m_start.notify_all();
+    fn(task, 0); // the caller is worker 0
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]
+                { return m_pending == 0; });
+    m_task = nullptr;
+    m_taskFn = nullptr;
+}
+
+void ThreadPool::WorkerLoop(unsigned int index)
+{
+    PROFILE_THREAD(); // before any task, the steps it runs must not allocate
+    unsigned long seen = 0UL;
+    while (true)
+    {
+        void *task = nullptr;
+        TaskFn fn = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&]
+                         { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+            seen = m_generation;
+            task = m_task;
+            fn = m_taskFn;
+        }
+        fn(task, index);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending == 0)
+                m_done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <barrier>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/* @brief
+ *   Fixed size fork-join pool for the data-parallel trainer
+ *   Run() hands the same task to every worker and returns once all of them finished,
+ *   the calling thread takes part as worker 0 so a pool of 1 spawns no thread at all
+ *   The task is passed by reference, not wrapped in a std::function, so Run() never allocates
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int numThreads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    inline unsigned int size() const { return m_size; }
+    // task(workerIndex) runs once on every worker, workerIndex in [0, size())
+    template <typename Task>
+    void Run(Task &&task)
+    {
+        RunTask(const_cast<void *>(static_cast<const void *>(&task)), [](void *t, unsigned int worker)
+                { (*static_cast<std::remove_reference_t<Task> *>(t))(worker); });
+    }
+    // inside a task, wait until every worker got here, reusable any number of times per Run()
+    inline void Sync() { m_barrier.arrive_and_wait(); }
+
+private:
+    using TaskFn = void (*)(void *task, unsigned int worker);
+    void RunTask(void *task, TaskFn fn);
+    void WorkerLoop(unsigned int index);
+
+    unsigned int m_size = 1U;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    void *m_task = nullptr; // the task of the current Run(), called through m_taskFn
+    TaskFn m_taskFn = nullptr;
+    unsigned long m_generation = 0UL; // bumped on every Run so workers know there is new work
+    unsigned int m_pending = 0U;      // helper threads still busy with the current task
+    bool m_stop = false;
+    std::barrier<> m_barrier; // allocates its state once, here, not in every step
+};
+
+#endif
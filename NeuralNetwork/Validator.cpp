@@ -0,0 +1,101 @@
+#include "Validator.hpp"
+
+template <typename T>
+Validator<T>::Validator(const std::vector<Layer<T>> &network, Evaluate evaluate) : m_evaluate(std::move(evaluate))
+{
+    // same shapes as the network, the weights are filled in by Submit()
+    std::size_t bytes = 0U;
+    for (const Layer<T> &layer : network)
+        bytes += Layer<T>::ArenaBytes(layer.size(), layer.NumInputs(), layer.HasMasterWeights());
+    m_arena.Reserve(bytes);
+    m_snapshot.reserve(network.size());
+    for (const Layer<T> &layer : network)
+    {
+        m_snapshot.emplace_back(layer.size(), layer.NumInputs(), layer.Bias(), layer.Function(), &m_arena);
+        if (layer.HasMasterWeights())
+            m_snapshot.back().EnableMasterWeights(); // so Restore() gives back the exact master weights
+    }
+    m_thread = std::thread(&Validator::Loop, this);
+}
+
+template <typename T>
+Validator<T>::~Validator()
+{
+    Stop();
+}
+
+template <typename T>
+bool Validator<T>::Submit(const std::vector<Layer<T>> &network, unsigned int epoch)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // an unpolled score belongs to the snapshot, overwriting it would pair that score with other weights
+        if (m_busy || m_hasResult || m_stop)
+            return false;
+        // the validation thread is idle, so the snapshot can be written without holding it up
+        for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
+            m_snapshot[index_layer].CopyWeights(network[index_layer]);
+        m_epoch = epoch;
+        m_busy = true;
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+template <typename T>
+bool Validator<T>::Poll(unsigned int &epoch, double &accuracy)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasResult)
+        return false;
+    m_hasResult = false;
+    epoch = m_epoch;
+    accuracy = m_accuracy;
+    return true;
+}
+
+template <typename T>
+void Validator<T>::Restore(std::vector<Layer<T>> &network)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]
+              { return !m_busy; });
+    for (auto index_layer = 1; index_layer < network.size(); ++index_layer)
+        network[index_layer].CopyWeights(m_snapshot[index_layer]);
+}
+
+template <typename T>
+void Validator<T>::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+template <typename T>
+void Validator<T>::Loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_cv.wait(lock, [this]
+                  { return m_busy || m_stop; });
+        if (!m_busy)
+            return; // stopped and idle
+        // score without the lock, Submit() backs off while m_busy is set
+        lock.unlock();
+        const double accuracy = m_evaluate(m_snapshot);
+        lock.lock();
+        m_accuracy = accuracy;
+        m_hasResult = true;
+        m_busy = false;
+        m_cv.notify_all(); // Restore() may be waiting
+    }
+}
+
+template class Validator<float>;
+template class Validator<double>;
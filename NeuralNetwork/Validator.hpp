@@ -0,0 +1,58 @@
+#pragma once
+#ifndef VALIDATOR_H
+#define VALIDATOR_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Arena.hpp"
+#include "Layer.hpp"
+
+/* @brief
+ *   Scores snapshots of the weights on a second thread while training goes on
+ *   Submit() copies the weights into the snapshot and wakes the validation thread,
+ *   when the previous snapshot is still being scored or its score was not polled yet the request is skipped,
+ *   training never waits. The snapshot is only rewritten by the next accepted Submit(), so the snapshot
+ *   behind the score Poll() returned is the one Restore() gives back.
+ *   Templated on the scalar type of the network, the snapshot keeps master weights when the network has them
+ */
+template <typename T>
+class Validator
+{
+public:
+    // called on the validation thread with the snapshot, returns its accuracy
+    using Evaluate = std::function<double(const std::vector<Layer<T>> &)>;
+
+    Validator(const std::vector<Layer<T>> &network, Evaluate evaluate);
+    ~Validator();
+    Validator(const Validator &) = delete;
+    Validator &operator=(const Validator &) = delete;
+
+    // training thread, false when the validation thread is still busy or its result was not polled
+    bool Submit(const std::vector<Layer<T>> &network, unsigned int epoch);
+    // newest finished score, false when nothing finished since the last call
+    bool Poll(unsigned int &epoch, double &accuracy);
+    // copy the last scored snapshot back into network (same topology)
+    void Restore(std::vector<Layer<T>> &network);
+    // let the running evaluation finish and join the thread
+    void Stop();
+
+private:
+    void Loop();
+
+    Arena m_arena; // backs m_snapshot, declared first so it goes last
+    std::vector<Layer<T>> m_snapshot;
+    Evaluate m_evaluate;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_busy = false; // snapshot submitted and not yet scored
+    bool m_stop = false;
+    bool m_hasResult = false;
+    unsigned int m_epoch = 0U; // epoch of the snapshot
+    double m_accuracy = 0.0;
+    std::thread m_thread;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <algorithm>
+#include <vector>
+#include "AlignedBuffer.hpp"
+#include "Arena.hpp"
+#include "Gemm.hpp"
+#include "Layer.hpp"
+
+/* @brief
+ *   Batch buffers of one layer, row r holds sample r of the batch
+ *   weightGradients and biasGradients are laid out like the layer weights and bias weights
+ */
+template <typename T>
+struct LayerBatch
+{
+    std::size_t outStride = 0U;  // padded row length of outputs
+    std::size_t gradStride = 0U; // padded row length of gradients
+    AlignedBuffer<T> outputs;
+    AlignedBuffer<T> gradients;
+    AlignedBuffer<T> weightGradients;
+    AlignedBuffer<T> biasGradients;
+    T *pack = nullptr; // GEMM packing buffer, one per workspace shared by all its layers (they run one after another)
+
+    inline T *Outputs(unsigned int row) { return outputs.data() + row * outStride; }
+    inline const T *Outputs(unsigned int row) const { return outputs.data() + row * outStride; }
+    inline T *Gradients(unsigned int row) { return gradients.data() + row * gradStride; }
+    inline const T *Gradients(unsigned int row) const { return gradients.data() + row * gradStride; }
+};
+
+/* @brief
+ *   Everything a forward/backward pass over a batch writes to, for every layer of the network
+ *   The network weights are only read, so each thread gets its own workspace
+ *   Allocated once up front (out of the model's arena when given one), the training step itself does not allocate
+ */
+template <typename T>
+class BatchWorkspace
+{
+public:
+    BatchWorkspace() = default;
+    // withGradients = false leaves out everything only the backward pass needs (inference)
+    BatchWorkspace(const std::vector<Layer<T>> &network, unsigned int batchSize, bool withGradients = true, Arena *arena = nullptr)
+        : m_capacity(batchSize), m_layers(network.size())
+    {
+        for (auto index_layer = 0; index_layer < network.size(); ++index_layer)
+        {
+            const Layer<T> &layer = network[index_layer];
+            LayerBatch<T> &batch = m_layers[index_layer];
+            batch.outStride = PaddedStride<T>(layer.size());
+            batch.gradStride = PaddedStride<T>(layer.size());
+            AllocateBuffer(batch.outputs, batchSize * batch.outStride, arena);
+            if (!withGradients)
+                continue;
+            AllocateBuffer(batch.gradients, batchSize * batch.gradStride, arena);
+            AllocateBuffer(batch.weightGradients, layer.size() * layer.Stride(), arena);
+            AllocateBuffer(batch.biasGradients, layer.size(), arena);
+        }
+        std::vector<unsigned short> topology;
+        for (const Layer<T> &layer : network)
+            topology.push_back(layer.size());
+        AllocateBuffer(m_pack, PackSize(topology, batchSize, withGradients), arena);
+        for (LayerBatch<T> &batch : m_layers)
+            batch.pack = m_pack.data();
+        if (!withGradients)
+            return;
+        AllocateBuffer(m_labels, batchSize, arena);
+        AllocateBuffer(m_sampleErrors, batchSize, arena);
+    }
+
+    // arena bytes the constructor takes for a network of topology, known before the layers exist
+    static std::size_t ArenaBytes(const std::vector<unsigned short> &topology, unsigned int batchSize, bool withGradients = true)
+    {
+        std::size_t bytes = 0U;
+        for (auto index_layer = 0; index_layer < topology.size(); ++index_layer)
+        {
+            const std::size_t numNeurons = topology[index_layer];
+            const std::size_t stride = PaddedStride<T>(index_layer == 0 ? 0 : topology[index_layer - 1]); // Layer<T>::Stride()
+            bytes += Arena::Footprint<T>(batchSize * PaddedStride<T>(numNeurons));
+            if (withGradients)
+                bytes += Arena::Footprint<T>(batchSize * PaddedStride<T>(numNeurons)) + Arena::Footprint<T>(numNeurons * stride) +
+                         Arena::Footprint<T>(numNeurons);
+        }
+        bytes += Arena::Footprint<T>(PackSize(topology, batchSize, withGradients));
+        if (withGradients)
+            bytes += Arena::Footprint<unsigned int>(batchSize) + Arena::Footprint<double>(batchSize);
+        return bytes;
+    }
+
+    // elements of GEMM packing buffer the largest product of a pass takes
+    static std::size_t PackSize(const std::vector<unsigned short> &topology, unsigned int batchSize, bool withGradients = true)
+    {
+        std::size_t size = 0U;
+        for (auto index_layer = 1; index_layer < topology.size(); ++index_layer)
+        {
+            const std::size_t numNeurons = topology[index_layer], numInputs = topology[index_layer - 1];
+            size = std::max(size, GemmPackSize<T>(batchSize, numNeurons, numInputs)); // FeedForwardBatch
+            if (!withGradients)
+                continue;
+            size = std::max(size, GemmPackSize<T>(numNeurons, numInputs, batchSize)); // CalcWeightGradients
+            if (index_layer + 1 < topology.size())
+                size = std::max(size, GemmPackSize<T>(batchSize, numNeurons, topology[index_layer + 1])); // CalcHiddenGradientsBatch
+        }
+        return size;
+    }
+
+    inline unsigned int Capacity() const { return m_capacity; }
+    inline LayerBatch<T> &operator[](std::size_t index_layer) { return m_layers[index_layer]; }
+    inline const LayerBatch<T> &operator[](std::size_t index_layer) const { return m_layers[index_layer]; }
+
+    // expected class of every sample of the batch
+    inline unsigned int *Labels() { return m_labels.data(); }
+    // RMS error of every sample of the batch
+    inline double *SampleErrors() { return m_sampleErrors.data(); }
+
+    // add another workspace's weight gradients into this one (tree reduction step)
+    void AccumulateWeightGradients(const BatchWorkspace &other)
+    {
+        for (auto index_layer = 1; index_layer < m_layers.size(); ++index_layer)
+        {
+            Accumulate(m_layers[index_layer].weightGradients, other.m_layers[index_layer].weightGradients);
+            Accumulate(m_layers[index_layer].biasGradients, other.m_layers[index_layer].biasGradients);
+        }
+    }
+
+private:
+    static void Accumulate(AlignedBuffer<T> &dst, const AlignedBuffer<T> &src)
+    {
+        T *d = dst.data();
+        const T *s = src.data();
+        for (std::size_t i = 0; i < dst.size(); ++i)
+            d[i] += s[i];
+    }
+
+    unsigned int m_capacity = 0U;
+    std::vector<LayerBatch<T>> m_layers;
+    AlignedBuffer<unsigned int> m_labels;
+    AlignedBuffer<double> m_sampleErrors;
+    AlignedBuffer<T> m_pack;
+};
+
+#endif
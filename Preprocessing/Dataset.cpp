@@ -1,101 +1,183 @@
 #include <fstream>
-#include <sstream>
 #include <iostream>
 #include <algorithm>
-#include <random>
+#include <charconv>
+#include <cstring>
+#include <numeric>
 #include "Dataset.hpp"
+#include "MappedFile.hpp"
+#include "Profiler.hpp"
+#include "TokenTable.hpp"
 
-using TokenMap = std::map<std::string, std::string>;
-
-Dataset::Dataset()
+template <typename T>
+Dataset<T>::Dataset()
 {
 }
 
-Dataset::~Dataset()
+template <typename T>
+Dataset<T>::~Dataset()
 {
 }
 
-void Dataset::ReadDataset(const std::string &filepath, const std::string &tokenfile)
+// Parse the whole (memory mapped) csv straight into one contiguous row-major buffer
+// Fields are parsed in place with std::from_chars, anything that is not a number has to be a token
+template <typename T>
+static void ParseCsv(const char *begin, const char *end, const TokenTable &tokens, RowMatrix<T> &matrix)
 {
-    std::cout << "Filepath : " << filepath << std::endl;
-    std::ifstream fs(filepath);
-    std::string line = "";
-    std::ifstream ts(tokenfile);
-    TokenMap m{};
-    std::vector<double> temp;
+    // one cheap pass to size the buffer: the line count and the column count of the first line
+    std::size_t lines = std::count(begin, end, '\n') + 1;
+    const char *firstEol = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+    matrix.cols = std::count(begin, firstEol ? firstEol : end, ',') + 1;
+    matrix.data.resize(lines * matrix.cols);
 
-    if (fs.is_open())
+    std::size_t row = 0U;
+    std::size_t lineNumber = 0U;
+    for (const char *line = begin; line < end;)
     {
-        // dataset has to replace non-numeric expressions
-        if (ts.is_open())
+        const char *eol = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        if (eol == nullptr)
+            eol = end;
+        const char *next = eol + 1;
+        ++lineNumber;
+        while (eol > line && std::isspace(static_cast<unsigned char>(eol[-1]))) // drops the '\r' of CRLF files
+            --eol;
+        if (eol == line) // skip blank lines
         {
-            json j = json::parse(ts);
-            for (auto &token : j["token"])
-                m.insert(std::make_pair(token["name"].get<std::string>(), token["value"].get<std::string>()));
+            line = next;
+            continue;
         }
-        ts.close(); // remember to close file to prevent leak
-        while (std::getline(fs, line))
+
+        T *out = matrix.data.data() + row * matrix.cols;
+        std::size_t col = 0U;
+        for (const char *field = line; field <= eol; ++col)
         {
-            // replace the tokens defined in json
-            if (!m.empty())
-                for (const auto &[k, v] : m)
+            const char *fieldEnd = static_cast<const char *>(std::memchr(field, ',', eol - field));
+            if (fieldEnd == nullptr)
+                fieldEnd = eol;
+            if (col >= matrix.cols) // a field past the last column, the row is wider than the first line
+            {
+                std::cerr << "Column count mismatched at line " << lineNumber << "! Expected " << matrix.cols << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            // trim the field
+            const char *fb = field, *fe = fieldEnd;
+            while (fb < fe && std::isspace(static_cast<unsigned char>(*fb)))
+                ++fb;
+            while (fe > fb && std::isspace(static_cast<unsigned char>(fe[-1])))
+                --fe;
+            auto [ptr, ec] = std::from_chars(fb, fe, out[col]);
+            if (ec != std::errc() || ptr != fe)
+            {
+                double token = 0.0;
+                if (!tokens.Find(std::string_view(fb, fe - fb), token))
                 {
-                    size_t pos = line.find(k); // return -1 if fail
-                    if (pos != -1)             // if found occurance
-                        line.replace(pos, k.length(), v);
-                    pos = -1;
+                    std::cerr << "Unrecognized value \"" << std::string_view(fb, fe - fb) << "\" at line " << lineNumber << std::endl;
+                    exit(EXIT_FAILURE);
                 }
-            // replace ',' with whitespace so that sstream can parse word by word
-            std::replace(line.begin(), line.end(), ',', ' ');
-            std::istringstream iss(line);
-            std::copy(std::istream_iterator<double>(iss),
-                      std::istream_iterator<double>(),
-                      std::back_inserter(temp)); // copy the data line by line into a temp container
-            m_data.d_parsed.emplace_back(temp);  // store the data in the class container
-            temp.clear();                        // remmeber to clear the temp container
+                out[col] = static_cast<T>(token);
+            }
+            field = fieldEnd + 1;
         }
-        fs.close(); // remember to close file to prevent leak
-        ShuffleData(m_data.d_parsed, m_data.d_shuffled);
-        return;
+        if (col != matrix.cols)
+        {
+            std::cerr << "Column count mismatched at line " << lineNumber << "! Expected " << matrix.cols << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        ++row;
+        line = next;
+    }
+    matrix.rows = row;
+    matrix.data.resize(row * matrix.cols);
+}
+
+template <typename T>
+void Dataset<T>::ReadDataset(const std::string &filepath, const std::string &tokenfile)
+{
+    std::cout << "Filepath : " << filepath << std::endl;
+    PROFILE_SCOPE(PHASE_DATA_ACCESS);
+    MappedFile file;
+    if (!file.Open(filepath))
+    {
+        std::cout << "Unable to open file" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // dataset has to replace non-numeric expressions
+    TokenTable tokens;
+    std::ifstream ts(tokenfile);
+    if (ts.is_open())
+    {
+        json j = json::parse(ts);
+        for (auto &token : j["token"])
+            tokens.Insert(token["name"].get<std::string>(), std::stod(token["value"].get<std::string>()));
+        tokens.Build();
     }
+    ts.close(); // remember to close file to prevent leak
 
-    std::cout << "Unable to open file" << std::endl;
-    exit(EXIT_FAILURE);
+    ParseCsv(file.data(), file.data() + file.size(), tokens, m_data.d_parsed);
+    // rows stay in file order, shuffling only permutes this index
+    m_data.d_order.resize(m_data.d_parsed.rows);
+    std::iota(m_data.d_order.begin(), m_data.d_order.end(), 0U);
+    PROFILE_COUNT(PHASE_DATA_ACCESS, 0U, file.size(), m_data.d_parsed.rows);
 }
 
-void Dataset::PrintData(DataType type) const
+template <typename T>
+void Dataset<T>::PrintData(DataType type) const
 {
-    Matrix2D<double> m_temp{};
+    // debug only, so the printed matrix is simply copied out of the views
+    Matrix2D<T> m_temp{};
+    auto copyRows = [&](const MatrixView<T> &view)
+    {
+        for (auto r = 0; r < view.rows; ++r)
+            m_temp.emplace_back(view[r].begin(), view[r].end());
+    };
     std::string s_temp = "";
     switch (type)
     {
     case RAW:
         s_temp = "RAW";
-        m_temp = m_data.d_parsed;
+        copyRows(m_data.d_parsed);
         break;
     case SHUFFLED:
         s_temp = "SHUFFLED";
-        m_temp = m_data.d_shuffled;
+        for (auto r : m_data.d_order)
+            m_temp.emplace_back(m_data.d_parsed[r].begin(), m_data.d_parsed[r].end());
         break;
+    case TRAINING:
+    case VALIDATION:
+    case TEST:
+    {
+        const IndexRange &range = (type == TRAINING) ? m_data.d_training : (type == VALIDATION) ? m_data.d_validation
+                                                                                                : m_data.d_test;
+        s_temp = (type == TRAINING) ? "TRAINING" : (type == VALIDATION) ? "VALIDATION"
+                                                                        : "TEST";
+        for (auto i = range.begin; i < range.end; ++i)
+            m_temp.emplace_back(m_data.d_parsed[m_data.d_order[i]].begin(), m_data.d_parsed[m_data.d_order[i]].end());
+        break;
+    }
     case IN:
         s_temp = "INPUT";
-        m_temp = m_data.in_vector;
+        copyRows(m_data.in_vector);
         break;
     case OUT:
         s_temp = "OUTPUT";
-        m_temp = m_data.out_vector;
+        copyRows(m_data.out_vector);
         break;
     case OUT_S:
         s_temp = "OUTPUT SPLITTED";
-        m_temp = m_data.out_vector_s;
+        for (auto label : m_data.out_class)
+        {
+            m_temp.emplace_back(m_data.numClasses, 0.0);
+            m_temp.back()[label] = 1.0;
+        }
         break;
     case IN_T:
         s_temp = "INPUT_TRANSPOSE";
-        m_temp = m_data.in_vector_t;
+        copyRows(GetTranspose(IN_T));
         break;
     case OUT_T:
         s_temp = "OUTPUT_TRANSPOSE";
-        m_temp = m_data.out_vector_t;
+        copyRows(GetTranspose(OUT_T));
         break;
     default:
         std::cout << "No Data Type Specified." << std::endl;
@@ -115,67 +197,141 @@ void Dataset::PrintData(DataType type) const
     std::cout << "-----------------------------------------------------" << std::endl;
 }
 
-// get the transpose for input and output vector
+// split the parsed data into input and output views
 // assuming that the output is positioned after the inputs then knowing the input size is enough
-void Dataset::ExtractInOut(const unsigned int in_size)
+template <typename T>
+void Dataset<T>::ExtractInOut(const unsigned int in_size, NORMALIZATION normalization)
 {
-    // sanity check .. use shuffled dataset
-    if (m_data.d_shuffled.empty())
+    // sanity check
+    if (m_data.d_parsed.empty())
         return;
+    if (in_size >= m_data.d_parsed.cols)
+    {
+        std::cerr << "Input size exceeds the dataset columns! " << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-    m_data.in_vector = m_data.d_shuffled;
-    for (auto &row : m_data.in_vector)
-        row.erase(row.begin() + in_size, row.end());
-    TransposeMatrix(m_data.in_vector, m_data.in_vector_t);
-
-    m_data.out_vector = m_data.d_shuffled;
-    for (auto &row : m_data.out_vector)
-        row.erase(row.begin(), row.begin() + in_size);
-    SplitOutput(m_data.out_vector, m_data.out_vector_s);
-    TransposeMatrix(m_data.out_vector, m_data.out_vector_t);
+    const RowMatrix<T> &parsed = m_data.d_parsed;
+    m_data.in_vector = MatrixView<T>(parsed.data.data(), parsed.rows, in_size, parsed.cols);
+    m_data.out_vector = MatrixView<T>(parsed.data.data() + in_size, parsed.rows, parsed.cols - in_size, parsed.cols);
+    SplitOutput(m_data.out_vector, m_data.out_class, m_data.numClasses);
+    // the scaling is fitted on the training rows only, validation and test rows must not leak into it,
+    // then every row's inputs are scaled in place (all rows take part when the data was never split)
+    const IndexRange fitRows = m_data.d_training.empty() ? IndexRange{0U, parsed.rows} : m_data.d_training;
+    m_normalizer.Reset(in_size);
+    if (normalization != NO_NORMALIZATION)
+        for (std::size_t i = fitRows.begin; i < fitRows.end; ++i)
+            m_normalizer.Push(parsed[m_data.d_order[i]].data());
+    m_normalizer.Fit(in_size, normalization);
+    m_normalizer.Transform(m_data.d_parsed.data.data(), parsed.cols, parsed.rows);
+    // views changed, drop the cached transposes
+    std::lock_guard<std::mutex> lock(m_transposeMutex);
+    m_inTranspose = RowMatrix<T>{};
+    m_outTranspose = RowMatrix<T>{};
 }
 
-// private functions
-void Dataset::ShuffleData(const Matrix2D<double> &matrix, Matrix2D<double> &matrix_s)
+template <typename T>
+void Dataset<T>::Rescale(const Normalizer &normalizer)
 {
-    // sanity check
-    if (matrix.empty())
+    if (m_data.d_parsed.empty())
         return;
+    if (normalizer.size() != m_data.in_vector.cols)
+    {
+        std::cerr << "Normalization size mismatched! Expected " << m_data.in_vector.cols << ", Found " << normalizer.size() << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    // back to the values read from the file, then scaled like the model was trained
+    RowMatrix<T> &parsed = m_data.d_parsed;
+    m_normalizer.Restore(parsed.data.data(), parsed.cols, parsed.rows);
+    m_normalizer = normalizer;
+    m_normalizer.Transform(parsed.data.data(), parsed.cols, parsed.rows);
+    std::lock_guard<std::mutex> lock(m_transposeMutex);
+    m_inTranspose = RowMatrix<T>{};
+    m_outTranspose = RowMatrix<T>{};
+}
+
+template <typename T>
+const RowMatrix<T> &Dataset<T>::GetTranspose(DataType type) const
+{
+    if (type != IN_T && type != OUT_T)
+    {
+        std::cerr << "Only IN_T and OUT_T have a transpose! " << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    const MatrixView<T> &matrix = (type == IN_T) ? m_data.in_vector : m_data.out_vector;
+    RowMatrix<T> &matrix_t = (type == IN_T) ? m_inTranspose : m_outTranspose;
+    std::lock_guard<std::mutex> lock(m_transposeMutex);
+    if (matrix_t.empty() && !matrix.empty())
+        TransposeMatrix(matrix, matrix_t);
+    return matrix_t;
+}
 
-    matrix_s = matrix;
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(matrix_s.begin(), matrix_s.end(), g); // random shuffle the dataset
+template <typename T>
+void Dataset<T>::ShuffleData(std::mt19937 &rng)
+{
+    std::shuffle(m_data.d_order.begin(), m_data.d_order.end(), rng); // random shuffle the row order
 }
 
-void Dataset::TransposeMatrix(const Matrix2D<double> &matrix, Matrix2D<double> &matrix_t)
+template <typename T>
+void Dataset<T>::SplitDataset(const double validationRatio, const double testRatio)
 {
-    std::vector<double> temp;
-    for (auto i = 0; i < matrix.front().size(); i++)
+    const std::size_t rows = m_data.d_order.size();
+    if (validationRatio < 0 || testRatio < 0 || validationRatio + testRatio >= 1)
     {
-        for (auto &row : matrix)
-            temp.emplace_back(row[i]);
-        matrix_t.emplace_back(temp);
-        temp.clear();
+        std::cerr << "Split ratios must be positive and leave rows for training! " << std::endl;
+        exit(EXIT_FAILURE);
     }
+    const std::size_t numValidation = static_cast<std::size_t>(rows * validationRatio);
+    const std::size_t numTest = static_cast<std::size_t>(rows * testRatio);
+    m_data.d_training = IndexRange{0U, rows - numValidation - numTest};
+    m_data.d_validation = IndexRange{m_data.d_training.end, m_data.d_training.end + numValidation};
+    m_data.d_test = IndexRange{m_data.d_validation.end, rows};
 }
 
-void Dataset::SplitOutput(const Matrix2D<double> &matrix, Matrix2D<double> &matrix_o)
+// private functions
+
+template <typename T>
+void Dataset<T>::TransposeMatrix(const MatrixView<T> &matrix, RowMatrix<T> &matrix_t)
 {
-    unsigned int maxVal = 0U;
-    for (auto &val : matrix)
+    // tile by tile, so both the rows read and the rows written stay in cache
+    constexpr std::size_t TILE = 32U;
+    matrix_t.rows = matrix.cols;
+    matrix_t.cols = matrix.rows;
+    matrix_t.data.resize(matrix.rows * matrix.cols);
+    for (std::size_t r0 = 0; r0 < matrix.rows; r0 += TILE)
     {
-        maxVal = maxVal > val[0] ? maxVal : val[0];
+        const std::size_t r1 = std::min(matrix.rows, r0 + TILE);
+        for (std::size_t c0 = 0; c0 < matrix.cols; c0 += TILE)
+        {
+            const std::size_t c1 = std::min(matrix.cols, c0 + TILE);
+            for (std::size_t r = r0; r < r1; ++r)
+            {
+                const T *src = matrix.data + r * matrix.stride;
+                for (std::size_t c = c0; c < c1; ++c)
+                    matrix_t.data[c * matrix_t.cols + r] = src[c];
+            }
+        }
     }
-    if (maxVal == 0)
-        return;
+}
 
-    std::vector<double> temp;
-    for (auto &val : matrix)
+// the output column holds class indices, keep them as indices instead of a dense one-hot matrix
+template <typename T>
+void Dataset<T>::SplitOutput(const MatrixView<T> &matrix, std::vector<unsigned int> &classes, unsigned int &numClasses)
+{
+    classes.resize(matrix.rows);
+    numClasses = 0U;
+    for (auto r = 0; r < matrix.rows; ++r)
     {
-        for (auto i = 0; i < maxVal + 1; ++i)
-            temp.emplace_back((val[0] == i) ? 1 : 0);
-        matrix_o.emplace_back(temp);
-        temp.clear();
+        T label = matrix[r][0];
+        if (label < 0 || label != static_cast<unsigned int>(label))
+        {
+            std::cerr << "Output is not a class index at row " << r + 1 << "! Found " << label << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        classes[r] = static_cast<unsigned int>(label);
+        numClasses = std::max(numClasses, classes[r] + 1);
     }
 }
+
+template class Dataset<float>;
+template class Dataset<double>;
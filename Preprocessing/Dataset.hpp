@@ -2,31 +2,76 @@
 #ifndef DATASET_H
 #define DATASET_H
 
+#include <mutex>
+#include <random>
+#include <span>
 #include <vector>
 #include "json.hpp"
+#include "Normalizer.hpp"
 
 using json = nlohmann::json;
 
 template <typename T>
 using Matrix2D = std::vector<std::vector<T>>;
 
+// contiguous row-major matrix, row r starts at data[r * cols]
+template <typename T>
+struct RowMatrix
+{
+    std::vector<T> data;
+    std::size_t rows = 0U;
+    std::size_t cols = 0U;
+
+    inline std::span<T> operator[](std::size_t r) { return {data.data() + r * cols, cols}; }
+    inline std::span<const T> operator[](std::size_t r) const { return {data.data() + r * cols, cols}; }
+    inline bool empty() const { return rows == 0; }
+};
+
+// non-owning strided view, row r starts at data[r * stride]
+// lets the input and output columns be read straight out of the parsed buffer
+template <typename T>
+struct MatrixView
+{
+    const T *data = nullptr;
+    std::size_t rows = 0U;
+    std::size_t cols = 0U;
+    std::size_t stride = 0U;
+
+    MatrixView() = default;
+    MatrixView(const T *data, std::size_t rows, std::size_t cols, std::size_t stride) : data(data), rows(rows), cols(cols), stride(stride) {}
+    MatrixView(const RowMatrix<T> &matrix) : data(matrix.data.data()), rows(matrix.rows), cols(matrix.cols), stride(matrix.cols) {}
+
+    inline std::span<const T> operator[](std::size_t r) const { return {data + r * stride, cols}; }
+    inline std::size_t size() const { return rows; }
+    inline bool empty() const { return rows == 0; }
+};
+
+// half open range [begin, end) of positions in the shuffled row order
+struct IndexRange
+{
+    std::size_t begin = 0U;
+    std::size_t end = 0U;
+
+    inline std::size_t size() const { return end - begin; }
+    inline bool empty() const { return begin == end; }
+};
+
 // class to process the dataset files, has functions to manipulate matrices
 // can consider making into abstract class with virtual fucntions
 template <typename T>
 struct DatasetStructure
 {
-    Matrix2D<T> d_parsed;     // Read raw data row by row and parsed it using token file
-    Matrix2D<T> d_shuffled;   // Shuffled the parsed data randomly
-    Matrix2D<T> in_vector;    // Get only the input vector
-    Matrix2D<T> out_vector;   // Get only the output vector
-    Matrix2D<T> out_vector_s; // Output vector split
-    Matrix2D<T> in_vector_t;  // Input vector transpose
-    Matrix2D<T> out_vector_t; // Output vector transpose
-
-    // Data split into 3 different sets
-    // Matrix2D<T> d_training;
-    // Matrix2D<T> d_validation;
-    // Matrix2D<T> d_test;
+    RowMatrix<T> d_parsed;     // Read raw data row by row and parsed it using token file
+    std::vector<unsigned int> d_order; // Shuffled row order, a permutation of the d_parsed rows
+    MatrixView<T> in_vector;   // Get only the input vector (view into d_parsed)
+    MatrixView<T> out_vector;  // Get only the output vector (view into d_parsed)
+    std::vector<unsigned int> out_class; // Class index of every row, expanded to one-hot on the fly by the loss
+    unsigned int numClasses = 0U;        // Width of the one-hot output
+
+    // Data split into 3 different sets, ranges of d_order so nothing is copied
+    IndexRange d_training;
+    IndexRange d_validation;
+    IndexRange d_test;
 };
 
 enum DataType
@@ -45,7 +90,9 @@ enum DataType
 
 // @remark 
 // consider making this into an abstract class for different dataset
-// use template <class T> and virtual functions
+// use virtual functions
+// T is the scalar type the values are parsed into (float or double), the network reads it without converting
+template <typename T>
 class Dataset
 {
 public:
@@ -53,15 +100,27 @@ public:
     ~Dataset(void);
 
     void ReadDataset(const std::string &filepath, const std::string &tokenfile);
-    void ExtractInOut(const unsigned int in_size);
-    // void SplitDataset(const double ratio); // @todo split into train, validation, test set
-    DatasetStructure<double> GetData() const { return m_data; }; // Read-Only
-    void PrintData(DataType) const;                              // For Debug
+    // normalization scales the input columns in place, so call it once per ReadDataset
+    // and after SplitDataset, the scaling is fitted on the training rows
+    void ExtractInOut(const unsigned int in_size, NORMALIZATION normalization = NO_NORMALIZATION);
+    // swap the fitted scaling for a given one (the one of an imported model), inputs are rescaled in place
+    void Rescale(const Normalizer &normalizer);
+    void ShuffleData(std::mt19937 &rng); // reshuffles d_order, the data itself never moves
+    // split the shuffled order into [training | validation | test], ratios are fractions of all rows
+    void SplitDataset(const double validationRatio, const double testRatio);
+    const DatasetStructure<T> &GetData() const { return m_data; }; // Read-Only, no copies
+    const Normalizer &GetNormalizer() const { return m_normalizer; };    // input scaling applied by ExtractInOut/Rescale
+    // IN_T or OUT_T, transposed on the first request and cached until the next ExtractInOut
+    const RowMatrix<T> &GetTranspose(DataType type) const;
+    void PrintData(DataType) const; // For Debug
 
 private:
-    DatasetStructure<double> m_data;
-    void ShuffleData(const Matrix2D<double> &matrix, Matrix2D<double> &matrix_s);
-    void SplitOutput(const Matrix2D<double> &matrix, Matrix2D<double> &matrix_o);
-    void TransposeMatrix(const Matrix2D<double> &matrix, Matrix2D<double> &matrix_t);
+    DatasetStructure<T> m_data;
+    Normalizer m_normalizer; // input scaling fitted on the training rows
+    mutable std::mutex m_transposeMutex;
+    mutable RowMatrix<T> m_inTranspose;  // Input vector transpose, lazy
+    mutable RowMatrix<T> m_outTranspose; // Output vector transpose, lazy
+    void SplitOutput(const MatrixView<T> &matrix, std::vector<unsigned int> &classes, unsigned int &numClasses);
+    static void TransposeMatrix(const MatrixView<T> &matrix, RowMatrix<T> &matrix_t);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <fstream>
+#include <new>
+#include <utility>
+#include "MappedFile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0U)), m_isMapped(other.m_isMapped)
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0U);
+        m_isMapped = other.m_isMapped;
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::string &path)
+{
+    Close();
+#ifdef HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *addr = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference to the file
+    if (addr == MAP_FAILED)
+        return false;
+    m_data = static_cast<char *>(addr);
+    m_size = st.st_size;
+    m_isMapped = true;
+    return true;
+#else
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f.is_open())
+        return false;
+    std::streamsize size = f.tellg();
+    if (size <= 0)
+        return false;
+    f.seekg(0);
+    m_data = static_cast<char *>(::operator new[](size, std::align_val_t(64)));
+    m_size = size;
+    m_isMapped = false;
+    if (!f.read(m_data, size))
+    {
+        Close();
+        return false;
+    }
+    return true;
+#endif
+}
+
+void MappedFile::Close()
+{
+    if (m_data == nullptr)
+        return;
+#ifdef HAS_MMAP
+    if (m_isMapped)
+        ::munmap(m_data, m_size);
+    else
+#endif
+        ::operator delete[](m_data, std::align_val_t(64));
+    m_data = nullptr;
+    m_size = 0U;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/* @brief
+ *   Read-only view of a whole file through mmap
+ *   The mapping is private: pages are shared with every other process mapping the same file
+ *   until someone writes to them, a write only copies the touched page (copy-on-write)
+ *   Platforms without mmap fall back to reading the file into memory
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // returns false when the file cannot be opened or mapped
+    bool Open(const std::string &path);
+    void Close();
+
+    inline bool IsOpen() const { return m_data != nullptr; }
+    inline char *data() { return m_data; }
+    inline const char *data() const { return m_data; }
+    inline std::size_t size() const { return m_size; }
+
+private:
+    char *m_data = nullptr;
+    std::size_t m_size = 0U;
+    bool m_isMapped = false; // false when the data came from the read fallback
+};
+
+#endif
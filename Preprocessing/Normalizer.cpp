@@ -0,0 +1,98 @@
+#include <cmath>
+#include <limits>
+#include "Normalizer.hpp"
+
+void Normalizer::Reset(std::size_t cols)
+{
+    m_count = 0U;
+    m_mean.assign(cols, 0.0);
+    m_m2.assign(cols, 0.0);
+    m_min.assign(cols, std::numeric_limits<double>::infinity());
+    m_max.assign(cols, -std::numeric_limits<double>::infinity());
+    Clear();
+}
+
+template <typename T>
+void Normalizer::Push(const T *row)
+{
+    // Welford's update, stable even when the mean is large compared to the spread
+    const double inv = 1.0 / ++m_count;
+    const std::size_t cols = m_mean.size();
+    double *mean = m_mean.data();
+    double *m2 = m_m2.data();
+    double *lo = m_min.data();
+    double *hi = m_max.data();
+    for (std::size_t c = 0; c < cols; ++c)
+    {
+        const double x = row[c];
+        const double delta = x - mean[c];
+        mean[c] += delta * inv;
+        m2[c] += delta * (x - mean[c]);
+        lo[c] = x < lo[c] ? x : lo[c];
+        hi[c] = x > hi[c] ? x : hi[c];
+    }
+}
+
+void Normalizer::Fit(std::size_t cols, NORMALIZATION mode)
+{
+    Clear();
+    if (mode == NO_NORMALIZATION || m_count == 0 || cols > m_mean.size())
+        return;
+    m_offsets.resize(cols);
+    m_scales.resize(cols);
+    for (std::size_t c = 0; c < cols; ++c)
+    {
+        // a constant column is only shifted
+        const double spread = (mode == STANDARDIZE) ? std::sqrt(m_m2[c] / m_count) : m_max[c] - m_min[c];
+        m_offsets[c] = (mode == STANDARDIZE) ? m_mean[c] : m_min[c];
+        m_scales[c] = (spread > 0.0) ? 1.0 / spread : 1.0;
+    }
+}
+
+void Normalizer::Load(const double *offsets, const double *scales, std::size_t cols)
+{
+    m_offsets.assign(offsets, offsets + cols);
+    m_scales.assign(scales, scales + cols);
+}
+
+void Normalizer::Clear()
+{
+    m_offsets.clear();
+    m_scales.clear();
+}
+
+template <typename T>
+void Normalizer::Transform(T *data, std::size_t stride, std::size_t rows) const
+{
+    // branch free inner loop over contiguous columns, vectorized by the compiler
+    const std::size_t cols = m_offsets.size();
+    const double *offset = m_offsets.data();
+    const double *scale = m_scales.data();
+    for (std::size_t r = 0; r < rows; ++r)
+    {
+        T *x = data + r * stride;
+        for (std::size_t c = 0; c < cols; ++c)
+            x[c] = static_cast<T>((x[c] - offset[c]) * scale[c]);
+    }
+}
+
+template <typename T>
+void Normalizer::Restore(T *data, std::size_t stride, std::size_t rows) const
+{
+    const std::size_t cols = m_offsets.size();
+    const double *offset = m_offsets.data();
+    const double *scale = m_scales.data();
+    for (std::size_t r = 0; r < rows; ++r)
+    {
+        T *x = data + r * stride;
+        for (std::size_t c = 0; c < cols; ++c)
+            x[c] = static_cast<T>(x[c] / scale[c] + offset[c]);
+    }
+}
+
+template void Normalizer::Push<float>(const float *);
+template void Normalizer::Push<double>(const double *);
+template void Normalizer::Transform<float>(float *, std::size_t, std::size_t) const;
+template void Normalizer::Transform<double>(double *, std::size_t, std::size_t) const;
+template void Normalizer::Restore<float>(float *, std::size_t, std::size_t) const;
+template void Normalizer::Restore<double>(double *, std::size_t, std::size_t) const;
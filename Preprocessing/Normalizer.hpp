@@ -0,0 +1,55 @@
+#pragma once
+#ifndef NORMALIZER_H
+#define NORMALIZER_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+enum NORMALIZATION
+{
+    NO_NORMALIZATION = 0,
+    STANDARDIZE, // (x - mean) / standard deviation
+    MINMAX       // (x - min) / (max - min)
+};
+
+/* @brief
+ *   Per column input scaling
+ *   Push() gathers mean/variance (Welford) and min/max while the rows stream in, one pass, no second scan
+ *   Fit() turns those into x' = (x - offset) * scale, Transform() applies it in place, Restore() undoes it
+ *   Offsets/scales are what gets saved with a model, Load() puts them back for inference
+ *   Statistics and the fitted transform stay in double, the data itself may be float or double
+ */
+class Normalizer
+{
+public:
+    void Reset(std::size_t cols);
+    template <typename T>
+    void Push(const T *row); // one row of Reset(cols) values
+    void Fit(std::size_t cols, NORMALIZATION mode); // first cols columns only (the inputs)
+    void Load(const double *offsets, const double *scales, std::size_t cols);
+    void Clear();
+    // rows of size() values, row r starts at data[r * stride]
+    template <typename T>
+    void Transform(T *data, std::size_t stride, std::size_t rows) const;
+    template <typename T>
+    void Restore(T *data, std::size_t stride, std::size_t rows) const; // x = x' / scale + offset
+
+    inline bool empty() const { return m_offsets.empty(); }
+    inline std::size_t size() const { return m_offsets.size(); }
+    inline std::span<const double> Offsets() const { return m_offsets; }
+    inline std::span<const double> Scales() const { return m_scales; }
+
+private:
+    // running column statistics
+    std::size_t m_count = 0U;
+    std::vector<double> m_mean;
+    std::vector<double> m_m2; // sum of squared deviations from the running mean
+    std::vector<double> m_min;
+    std::vector<double> m_max;
+    // fitted transform
+    std::vector<double> m_offsets;
+    std::vector<double> m_scales;
+};
+
+#endif
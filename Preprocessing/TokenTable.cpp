@@ -0,0 +1,65 @@
+#include "TokenTable.hpp"
+
+void TokenTable::Insert(const std::string &name, double value)
+{
+    // first definition wins, a duplicate would never hash into its own slot
+    for (const auto &existing : m_names)
+        if (existing == name)
+            return;
+    m_names.push_back(name);
+    m_values.push_back(value);
+}
+
+void TokenTable::Build()
+{
+    if (m_names.empty())
+        return;
+    // start at twice the token count, grow the table whenever a bunch of seeds all collide
+    std::uint64_t size = 1U;
+    while (size < 2 * m_names.size())
+        size <<= 1;
+    while (true)
+    {
+        m_mask = size - 1;
+        for (std::uint64_t seed = 1; seed <= 256; ++seed)
+        {
+            m_slots.assign(size, 0U);
+            bool isPerfect = true;
+            for (std::uint32_t i = 0; isPerfect && i < m_names.size(); ++i)
+            {
+                std::uint32_t &slot = m_slots[Hash(m_names[i], seed) & m_mask];
+                isPerfect = (slot == 0U);
+                slot = i + 1;
+            }
+            if (isPerfect)
+            {
+                m_seed = seed;
+                return;
+            }
+        }
+        size <<= 1;
+    }
+}
+
+bool TokenTable::Find(std::string_view field, double &value) const
+{
+    if (m_slots.empty())
+        return false;
+    std::uint32_t slot = m_slots[Hash(field, m_seed) & m_mask];
+    if (slot == 0U || m_names[slot - 1] != field)
+        return false;
+    value = m_values[slot - 1];
+    return true;
+}
+
+std::uint64_t TokenTable::Hash(std::string_view s, std::uint64_t seed)
+{
+    // FNV-1a with the seed mixed into the offset basis
+    std::uint64_t hash = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (unsigned char c : s)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash ^ (hash >> 29);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef TOKENTABLE_H
+#define TOKENTABLE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* @brief
+ *   Maps the non-numeric tokens of a dataset (class names ...) to their numeric value
+ *   Build() searches a hash seed that puts every token in its own slot (perfect hash),
+ *   so a lookup is one hash of the field plus one string compare
+ */
+class TokenTable
+{
+public:
+    void Insert(const std::string &name, double value);
+    void Build(); // call once after the last Insert
+    // true and value set when field is a known token
+    bool Find(std::string_view field, double &value) const;
+    inline bool empty() const { return m_names.empty(); }
+
+private:
+    static std::uint64_t Hash(std::string_view s, std::uint64_t seed);
+    std::vector<std::string> m_names;
+    std::vector<double> m_values;
+    std::vector<std::uint32_t> m_slots; // index + 1 into m_names, 0 for an empty slot
+    std::uint64_t m_seed = 0U;
+    std::uint64_t m_mask = 0U;
+};
+
+#endif